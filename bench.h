@@ -15,6 +15,7 @@
 #include <cassert>
 #include <thread>
 #include <fstream>
+#include <functional>
 
 #include "position.h"
 #include "types.h"
@@ -26,6 +27,13 @@
 #include "epd.hpp"
 #include "options.h"
 #include "parameter.h"
+#include "bitboards.h"
+#include "magics.h"
+#include "material.h"
+#include "zobrist.h"
+#include "perfttable.h"
+#include "threads.h"
+#include "syzygy.h"
 
 std::mutex mtx;
 
@@ -67,17 +75,32 @@ public:
 	Perft& operator=(const Perft& p) = delete;
 	Perft& operator=(const Perft&& p) = delete;
 
-	inline void go(const int& depth);
+	inline void go(const int& depth, const unsigned& threads, const size_t& hash_mb);
 	inline U64 search(position& p, const int& depth);
+	inline U64 search(position& p, const int& depth, perft_table& tt);
+	inline U64 parallel_search(position& p, const int& depth, const unsigned& threads, perft_table& tt);
+	inline void suite(const std::string& filename, const int& max_depth, const unsigned& threads, const size_t& hash_mb);
 	inline void divide(position& p, int d);
 	inline void gen(position& p, U64& times);
 	inline double pbil_search(position& p, const int& depth, scores& S, bool silent);
 	inline void auto_tune();
-	inline void bench(const int& depth, bool silent);
+	inline void bench(const int& depth, const std::string& filename, bool silent);
+	inline void pawn_bench(const std::string& filename, const int& iterations);
+	inline void eval_bench(const std::string& filename, const unsigned& threads, const int& repeat);
+	inline void startup_bench(const int& iterations);
+	inline void rep_bench(const std::string& filename, const int& plies, const int& iterations);
+	inline void see_bench(const std::string& filename, const int& iterations);
+	inline void check_gen(const std::string& filename, const int& plies);
+	inline void tb_test(const std::string& filename);
 };
 
 
-inline void Perft::go(const int& depth) {
+/// <summary>
+/// Perft over the standard test positions, root moves are split across 'threads'
+/// and subtree counts are cached in a perft table of 'hash_mb' (0 disables it).
+/// Expected counts are only known up to depth 7, deeper runs print 0 as reference.
+/// </summary>
+inline void Perft::go(const int& depth, const unsigned& threads, const size_t& hash_mb) {
 
 	std::string positions[5] =
 	{
@@ -95,33 +118,58 @@ inline void Perft::go(const int& depth) {
 					{ 6,   264,  9467,  422333,  15833292, 706045033,          0 },
 					{ 42, 1352, 53392,       0,         0,         0,          0 } };
 
-	if (depth > 7) {
-		std::cout << "Abort, max depth = 7" << std::endl;
-		return;
-	}
+	perft_table tt(hash_mb);
 
 	U64 nb = 0ULL;
+	U64 total_nodes = 0ULL;
+	double total_ms = 0;
 	for (int i = 0; i < 5; ++i) {
 		std::istringstream fen(positions[i]);
 		position board(fen);
+		tt.clear();
 
 		std::cout << "Position : " << positions[i] << std::endl;
 		std::cout << "" << std::endl;
 		for (int d = 0; d < depth; d++) {
 			tot_timer.start();
-			nb = search(board, d + 1);
+			nb = parallel_search(board, d + 1, threads, tt);
 			tot_timer.stop();
+			total_nodes += nb;
+			total_ms += tot_timer.ms();
 			std::cout << "depth "
 				<< (d + 1) << "\t"
 				<< std::right << std::setw(14)
-				<< results[i][d]
+				<< (d < 7 ? results[i][d] : 0)
 				<< "\t" << "perft " << std::setw(14)
 				<< nb << "\t " << std::setw(15)
-				<< tot_timer.ms() << " ms " << std::endl;
+				<< tot_timer.ms() << " ms " << std::setw(10)
+				<< (tot_timer.ms() > 0 ? U64(nb / tot_timer.ms()) : 0) << " knps" << std::endl;
+		}
+
+		// do/undo cost, timed over the legal root moves only
+		Movegen mvs(board);
+		mvs.generate<pseudo_legal, pieces>();
+		std::vector<Move> legal;
+		for (int j = 0; j < mvs.size(); ++j) {
+			if (board.is_legal(mvs[j])) legal.push_back(mvs[j]);
+		}
+		const int reps = 100000;
+		dom_timer.start();
+		for (int r = 0; r < reps; ++r) {
+			for (auto& m : legal) {
+				board.do_move(m);
+				board.undo_move(m);
+			}
 		}
+		dom_timer.stop();
+		std::cout << "do/undo-mv time: "
+			<< (legal.empty() ? 0 : 1e6 * dom_timer.ms() / (double(reps) * legal.size())) << " ns " << std::endl;
 		std::cout << "" << std::endl;
 		std::cout << "" << std::endl;
 	}
+	std::cout << "total " << total_nodes << " nodes " << total_ms << " ms "
+		<< (total_ms > 0 ? total_nodes / (1000 * total_ms) : 0) << " Mnps"
+		<< " (threads " << threads << ", hash " << hash_mb << " mb)" << std::endl;
 }
 
 inline void Perft::gen(position& p, U64& times) {
@@ -251,6 +299,145 @@ inline U64 Perft::search(position& p, const int& depth) {
 	return cnt;
 }
 
+/// <summary>
+/// Perft with subtree counts cached per (key, depth), depth 1 is still bulk counted.
+/// </summary>
+inline U64 Perft::search(position& p, const int& depth, perft_table& tt) {
+	if (depth <= 1 || !tt.enabled())
+		return search(p, depth);
+
+	U64 cnt = 0;
+	const U64 key = p.key();
+	if (tt.fetch(key, depth, cnt))
+		return cnt;
+
+	Movegen mvs(p);
+	mvs.generate<pseudo_legal, pieces>();
+
+	for (int i = 0; i < mvs.size(); ++i) {
+
+		if (!p.is_legal(mvs[i])) {
+			continue;
+		}
+
+		p.do_move(mvs[i]);
+		cnt += search(p, depth - 1, tt);
+		p.undo_move(mvs[i]);
+	}
+
+	tt.save(key, depth, cnt);
+	return cnt;
+}
+
+/// <summary>
+/// Splits the legal root moves across a thread pool, each worker searches
+/// its moves on a private copy of the position and all workers share the perft table.
+/// </summary>
+inline U64 Perft::parallel_search(position& p, const int& depth, const unsigned& threads, perft_table& tt) {
+	if (depth <= 1 || threads <= 1)
+		return search(p, depth, tt);
+
+	Movegen mvs(p);
+	mvs.generate<pseudo_legal, pieces>();
+	std::vector<Move> roots;
+	for (int i = 0; i < mvs.size(); ++i) {
+		if (p.is_legal(mvs[i])) roots.push_back(mvs[i]);
+	}
+
+	std::atomic<U64> total(0);
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		position local(p);
+		for (size_t i = next.fetch_add(1); i < roots.size(); i = next.fetch_add(1)) {
+			local.do_move(roots[i]);
+			total += search(local, depth - 1, tt);
+			local.undo_move(roots[i]);
+		}
+	};
+
+	unsigned n = std::min(threads, unsigned(roots.size()));
+	Threadpool<Workerthread> pool(n);
+	for (unsigned i = 0; i < n; ++i)
+		pool.enqueue(worker);
+	pool.wait_finished();
+
+	return total;
+}
+
+/// <summary>
+/// Runs an epd perft suite ("fen ;D1 20 ;D2 400 ..."), every listed depth up to max_depth
+/// is checked. The suite is run single threaded and with 'threads' to report Mnps per thread count.
+/// </summary>
+inline void Perft::suite(const std::string& filename, const int& max_depth, const unsigned& threads, const size_t& hash_mb) {
+
+	struct perft_case {
+		std::string fen;
+		std::vector<std::pair<int, U64>> expected;
+	};
+
+	std::vector<perft_case> cases;
+	std::ifstream file(filename);
+	std::string line;
+	while (std::getline(file, line)) {
+		std::vector<std::string> tokens = util::split(line, ';');
+		if (tokens.size() < 2)
+			continue;
+
+		perft_case c;
+		c.fen = tokens[0];
+		for (size_t i = 1; i < tokens.size(); ++i) {
+			std::istringstream ts(tokens[i]);
+			std::string d;
+			U64 n = 0;
+			if (ts >> d >> n && d.size() > 1 && d[0] == 'D') {
+				int depth = atoi(d.c_str() + 1);
+				if (depth >= 1 && depth <= max_depth) c.expected.emplace_back(depth, n);
+			}
+		}
+		if (!c.expected.empty()) cases.push_back(c);
+	}
+
+	if (cases.empty()) {
+		std::cout << "perft suite: no positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	perft_table tt(hash_mb);
+
+	auto run = [&](const unsigned& n, const bool& verbose) {
+		U64 nodes = 0ULL;
+		double ms = 0;
+		size_t failures = 0;
+		for (size_t i = 0; i < cases.size(); ++i) {
+			std::istringstream fen(cases[i].fen);
+			position board(fen);
+			tt.clear();
+			for (auto& [d, expected] : cases[i].expected) {
+				tot_timer.start();
+				U64 nb = parallel_search(board, d, n, tt);
+				tot_timer.stop();
+				nodes += nb;
+				ms += tot_timer.ms();
+				failures += (nb != expected);
+				if (verbose || nb != expected)
+					std::cout << (nb == expected ? "ok   " : "FAIL ") << i + 1 << " depth " << d
+						<< " expected " << expected << " perft " << nb << " " << tot_timer.ms() << " ms" << std::endl;
+			}
+		}
+		std::cout << "perft suite threads " << n
+			<< " positions " << cases.size()
+			<< " nodes " << nodes
+			<< " ms " << ms
+			<< " Mnps " << (ms > 0 ? nodes / (1000 * ms) : 0)
+			<< " failures " << failures << std::endl;
+	};
+
+	run(1, true);
+	if (threads > 1)
+		run(threads, false);
+}
+
 
 inline void update_options_file(const position& p) {
 	using namespace eval;
@@ -288,7 +475,21 @@ inline void update_options_file(const position& p) {
 	opts->set<float>("king s6", p.params.king_safe_sqs[5]);
 	opts->set<float>("king s7", p.params.king_safe_sqs[6]);
 	opts->set<float>("king s8", p.params.king_safe_sqs[7]);
+	opts->set<float>("rfp margin", p.params.rfp_margin);
+	opts->set<float>("rfp depth", p.params.rfp_depth);
+	opts->set<float>("lmr hist", p.params.lmr_history_divisor);
+	opts->set<float>("lmr cut", p.params.lmr_cut_node);
+	opts->set<float>("hist prune depth", p.params.history_prune_depth);
+	opts->set<float>("hist prune margin", p.params.history_prune_margin);
+	opts->set<float>("singular depth", p.params.singular_depth);
+	opts->set<float>("singular margin", p.params.singular_margin);
+	opts->set<float>("probcut depth", p.params.probcut_depth);
+	opts->set<float>("probcut margin", p.params.probcut_margin);
+	opts->set<float>("iid depth", p.params.iid_depth);
+	opts->set<float>("iid reduction", p.params.iid_reduction);
+	opts->set<float>("iir depth", p.params.iir_depth);
 	opts->set<int>("fixed depth", p.params.fixed_depth);
+	opts->set<int>("qsearch checks", p.params.qsearch_checks);
 
 	//opts->save_param_file(std::string(""));
 }
@@ -359,11 +560,28 @@ inline double pbil_residual(const std::vector<int>& new_bits) {
 	p.params.king_safe_sqs[5] = new_params[28];
 	p.params.king_safe_sqs[6] = new_params[29];
 	p.params.king_safe_sqs[7] = new_params[30];
+	p.params.rfp_margin = new_params[31];
+	p.params.rfp_depth = new_params[32];
+	p.params.lmr_history_divisor = new_params[33];
+	p.params.lmr_cut_node = new_params[34];
+	p.params.history_prune_depth = new_params[35];
+	p.params.history_prune_margin = new_params[36];
+	p.params.singular_depth = new_params[37];
+	p.params.singular_margin = new_params[38];
+	p.params.probcut_depth = new_params[39];
+	p.params.probcut_margin = new_params[40];
+	p.params.iid_depth = new_params[41];
+	p.params.iid_reduction = new_params[42];
+	p.params.iir_depth = new_params[43];
 
 	ttable.clear();
 	//mtable.clear();
 	//ptable.clear();
 
+	// cached evaluations are stale once the parameters change
+	for (unsigned i = 0; i < SearchThreads.num_workers(); ++i)
+		SearchThreads[i]->evalTable.clear();
+
 	scores S;
 	Perft perft;
 	unsigned depth = 8;
@@ -419,7 +637,20 @@ inline void Perft::auto_tune() {
 		eval::Parameters.king_safe_sqs[4],
 		eval::Parameters.king_safe_sqs[5],
 		eval::Parameters.king_safe_sqs[6],
-		eval::Parameters.king_safe_sqs[7]
+		eval::Parameters.king_safe_sqs[7],
+		eval::Parameters.rfp_margin,
+		eval::Parameters.rfp_depth,
+		eval::Parameters.lmr_history_divisor,
+		eval::Parameters.lmr_cut_node,
+		eval::Parameters.history_prune_depth,
+		eval::Parameters.history_prune_margin,
+		eval::Parameters.singular_depth,
+		eval::Parameters.singular_margin,
+		eval::Parameters.probcut_depth,
+		eval::Parameters.probcut_margin,
+		eval::Parameters.iid_depth,
+		eval::Parameters.iid_reduction,
+		eval::Parameters.iir_depth
 	};
 
 
@@ -499,9 +730,9 @@ inline double Perft::pbil_search(position& p, const int& depth, scores& S, bool
 	return minimized_score;
 }
 
-inline void Perft::bench(const int& depth, bool silent) {
+inline void Perft::bench(const int& depth, const std::string& filename, bool silent) {
 
-	pbil_score::E = util::make_unique<epd>("A:\\code\\chess\\sbchess\\tuning\\epd\\mini-test.txt");
+	pbil_score::E = util::make_unique<epd>(filename);
 	std::vector<epd_entry> positions = pbil_score::E->get_positions();
 	std::vector<std::string> csv_data;
 
@@ -516,6 +747,15 @@ inline void Perft::bench(const int& depth, bool silent) {
 	S.total = positions.size();
 	size_t counter = 1;
 
+	for (unsigned i = 0; i < SearchThreads.num_workers(); ++i) {
+		SearchThreads[i]->evalTable.clear_stats();
+		SearchThreads[i]->pawnTable.clear_stats();
+		SearchThreads[i]->ttEvals = SearchThreads[i]->fullEvals = 0;
+		SearchThreads[i]->probcutTries = SearchThreads[i]->probcutCuts = 0;
+		SearchThreads[i]->failHighs = SearchThreads[i]->failHighsFirst = 0;
+		SearchThreads[i]->aspirationIterations = SearchThreads[i]->aspirationFailLows = SearchThreads[i]->aspirationFailHighs = 0;
+	}
+
 	for (const epd_entry& e : positions) {
 
 		std::cout << "test pos: " << counter << "/" << positions.size() << " correct: " << S.correct << "/" << S.total << "\r" << std::flush;
@@ -556,11 +796,70 @@ inline void Perft::bench(const int& depth, bool silent) {
 	avg_nps /= 1e6;
 	S.acc_score = ((float)(S.correct / (float)S.total));
 
+	// static eval cache hit-rate over all search threads
+	U64 eval_probes = 0;
+	U64 eval_hits = 0;
+	U64 pawn_probes = 0;
+	U64 pawn_hits = 0;
+	U64 tt_evals = 0;
+	U64 full_evals = 0;
+	U64 probcut_tries = 0;
+	U64 probcut_cuts = 0;
+	U64 fail_highs = 0;
+	U64 fail_highs_first = 0;
+	U64 asp_iterations = 0;
+	U64 asp_fail_lows = 0;
+	U64 asp_fail_highs = 0;
+	for (unsigned i = 0; i < SearchThreads.num_workers(); ++i) {
+		tt_evals += SearchThreads[i]->ttEvals;
+		full_evals += SearchThreads[i]->fullEvals;
+		probcut_tries += SearchThreads[i]->probcutTries;
+		probcut_cuts += SearchThreads[i]->probcutCuts;
+		fail_highs += SearchThreads[i]->failHighs;
+		fail_highs_first += SearchThreads[i]->failHighsFirst;
+		asp_iterations += SearchThreads[i]->aspirationIterations;
+		asp_fail_lows += SearchThreads[i]->aspirationFailLows;
+		asp_fail_highs += SearchThreads[i]->aspirationFailHighs;
+		eval_probes += SearchThreads[i]->evalTable.probe_count();
+		eval_hits += SearchThreads[i]->evalTable.hit_count();
+		pawn_probes += SearchThreads[i]->pawnTable.probe_count();
+		pawn_hits += SearchThreads[i]->pawnTable.hit_count();
+	}
+	double eval_hit_rate = (eval_probes > 0 ? (double)eval_hits / (double)eval_probes : 0.0);
+	double pawn_hit_rate = (pawn_probes > 0 ? (double)pawn_hits / (double)pawn_probes : 0.0);
+
+	std::cout << std::endl;
+	std::cout << "depth " << depth
+		<< " correct " << S.correct << "/" << S.total
+		<< " avg ms " << avg_time_ms
+		<< " avg nodes " << avg_nodes
+		<< " avg qnodes " << avg_qnodes
+		<< " avg MNPS " << avg_nps << std::endl;
+	std::cout << "eval cache probes " << eval_probes
+		<< " hits " << eval_hits
+		<< " hit-rate " << eval_hit_rate << std::endl;
+	std::cout << "pawn table probes " << pawn_probes
+		<< " hits " << pawn_hits
+		<< " hit-rate " << pawn_hit_rate << std::endl;
+	std::cout << "static evals " << (tt_evals + full_evals)
+		<< " from tt " << tt_evals
+		<< " evaluated " << full_evals
+		<< " avoided " << (tt_evals + full_evals > 0 ? (double)tt_evals / (double)(tt_evals + full_evals) : 0.0) << std::endl;
+	std::cout << "probcut tries " << probcut_tries
+		<< " cuts " << probcut_cuts
+		<< " cut-rate " << (probcut_tries > 0 ? (double)probcut_cuts / (double)probcut_tries : 0.0) << std::endl;
+	std::cout << "fail highs " << fail_highs
+		<< " first move " << fail_highs_first
+		<< " first-rate " << (fail_highs > 0 ? (double)fail_highs_first / (double)fail_highs : 0.0) << std::endl;
+	std::cout << "aspiration iterations " << asp_iterations
+		<< " re-searches " << (asp_fail_lows + asp_fail_highs)
+		<< " (fail low " << asp_fail_lows << " fail high " << asp_fail_highs << ")"
+		<< " per iteration " << (asp_iterations > 0 ? (double)(asp_fail_lows + asp_fail_highs) / (double)asp_iterations : 0.0) << std::endl;
 
 	std::ofstream result_csv("mini-test-result.csv", std::ios_base::app);
 
 	result_csv << "\n";
-	result_csv << "depth, acc, corr, total, avg ms, avg nodes, avg qnodes, avg MNPS\n";
+	result_csv << "depth, acc, corr, total, avg ms, avg nodes, avg qnodes, avg MNPS, eval probes, eval hits, eval hit-rate, pawn hit-rate\n";
 	result_csv <<
 		depth << "," <<
 		S.acc_score << "," <<
@@ -569,9 +868,542 @@ inline void Perft::bench(const int& depth, bool silent) {
 		avg_time_ms << "," <<
 		avg_nodes << "," <<
 		avg_qnodes << "," <<
-		avg_nps << "\n";
+		avg_nps << "," <<
+		eval_probes << "," <<
+		eval_hits << "," <<
+		eval_hit_rate << "," <<
+		pawn_hit_rate << "\n";
 
 	result_csv.close();
 }
 
+/// <summary>
+/// Pawn structure evaluation micro-benchmark (pawn table bypassed).
+/// Structures are taken from every position of the games in a .pgn file, or from an epd file,
+/// keeping one position per distinct pawn key.
+/// </summary>
+inline void Perft::pawn_bench(const std::string& filename, const int& iterations) {
+
+	std::vector<std::string> fens;
+	std::vector<U64> keys;
+	auto add_structure = [&](const position& p) {
+		if (std::find(keys.begin(), keys.end(), p.pawnkey()) != keys.end())
+			return;
+		keys.push_back(p.pawnkey());
+		fens.push_back(p.to_fen());
+	};
+
+	bool is_pgn = filename.size() > 4 && filename.substr(filename.size() - 4) == ".pgn";
+	if (is_pgn) {
+		pgn games(std::vector<std::string>{ filename });
+		for (const game& g : games.parsed_games()) {
+			std::istringstream fen(START_FEN);
+			position p(fen);
+			add_structure(p);
+			for (const Move& m : g.moves) {
+				p.do_move(m);
+				add_structure(p);
+			}
+		}
+	}
+	else {
+		epd positions(filename);
+		for (const epd_entry& e : positions.get_positions()) {
+			std::istringstream fen(e.pos);
+			position p(fen);
+			add_structure(p);
+		}
+	}
+
+	if (fens.empty()) {
+		std::cout << "pawn bench: no positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	pawn_entry e;
+	double total_ms = 0;
+	long long checksum = 0;
+	position p;
+
+	for (const std::string& f : fens) {
+		std::istringstream fen(f);
+		p.setup(fen);
+
+		tot_timer.start();
+		for (int i = 0; i < iterations; ++i)
+			checksum += pawns::evaluate(p, e);
+		tot_timer.stop();
+		total_ms += tot_timer.ms();
+	}
+
+	double evals = double(fens.size()) * iterations;
+	std::cout << "pawn bench structures " << fens.size()
+		<< " evals " << (U64)evals
+		<< " total ms " << total_ms
+		<< " ns/eval " << (total_ms * 1e6 / evals)
+		<< " checksum " << checksum << std::endl;
+}
+
+/// <summary>
+/// Batch evaluation throughput (single thread vs. threads) over the positions of an epd file,
+/// repeated to get a measurable amount of work. Batch scores are checked against eval::evaluate,
+/// the term breakdown is checked to sum to the white relative score with either side to move.
+/// </summary>
+inline void Perft::eval_bench(const std::string& filename, const unsigned& threads, const int& repeat) {
+
+	epd positions(filename);
+	std::vector<std::string> fens;
+	for (int r = 0; r < repeat; ++r) {
+		for (const epd_entry& e : positions.get_positions())
+			fens.push_back(e.pos);
+	}
+
+	if (fens.empty()) {
+		std::cout << "eval bench: no positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	std::vector<float> scores(fens.size());
+	std::vector<term_scores> terms(fens.size());
+
+	// validate against the search evaluation (one copy of the positions)
+	size_t mismatches = 0;
+	size_t unique = positions.get_positions().size();
+	eval::evaluate_batch(std::span<const std::string>(fens.data(), unique), scores, terms, 1);
+	SearchThreads[0]->evalTable.clear();
+	for (size_t i = 0; i < unique; ++i) {
+		std::istringstream fen(fens[i]);
+		position p(fen);
+		p.params = eval::Parameters;
+		float expected = eval::evaluate(p, *SearchThreads[0], -1);
+		mismatches += (std::abs(expected - scores[i]) > 1e-3f);
+	}
+
+	// the same positions with the other side to move (skipped when the side that moved would be in check)
+	std::vector<std::string> checked(fens.begin(), fens.begin() + unique);
+	for (size_t i = 0; i < unique; ++i) {
+		std::istringstream fen(fens[i]);
+		position p(fen);
+		if (p.in_check())
+			continue;
+		std::istringstream ss(fens[i]);
+		std::string board, stm, castle;
+		ss >> board >> stm >> castle;
+		checked.push_back(board + (stm == "w" ? " b " : " w ") + castle + " -");
+	}
+
+	std::vector<float> checked_scores(checked.size());
+	std::vector<term_scores> checked_terms(checked.size());
+	eval::evaluate_batch(checked, checked_scores, checked_terms, 1);
+	size_t breakdown_mismatches = 0;
+	for (size_t i = 0; i < checked.size(); ++i) {
+		std::istringstream fen(checked[i]);
+		position p(fen);
+		float white_score = (p.to_move() == white ? checked_scores[i] : -checked_scores[i]);
+		float sum = 0;
+		for (const float& t : checked_terms[i])
+			sum += t;
+		breakdown_mismatches += (std::abs(sum - white_score) > 1e-2f);
+	}
+
+	auto run = [&](const unsigned& n) {
+		tot_timer.start();
+		eval::evaluate_batch(fens, scores, terms, n);
+		tot_timer.stop();
+		double ms = tot_timer.ms();
+		std::cout << "eval bench threads " << n
+			<< " positions " << fens.size()
+			<< " ms " << ms
+			<< " positions/sec " << (U64)(fens.size() / ms * 1000.0) << std::endl;
+	};
+
+	run(1);
+	if (threads > 1)
+		run(threads);
+	std::cout << "eval bench mismatches vs eval::evaluate " << mismatches << "/" << unique << std::endl;
+	std::cout << "eval bench breakdown mismatches vs white relative score " << breakdown_mismatches << "/" << checked.size() << std::endl;
+}
+
+/// <summary>
+/// Startup cost per initialization phase. The bitboard, zobrist and material tables are generated
+/// at compile time (reported by size only), slider attacks are still built at runtime and the
+/// transposition table is allocated lazily on the first isready/go.
+/// </summary>
+inline void Perft::startup_bench(const int& iterations) {
+
+	size_t static_bytes =
+		sizeof(bitboards::between) + sizeof(bitboards::reductions) + sizeof(bitboards::pattks) +
+		sizeof(bitboards::front_region) + sizeof(bitboards::passpawn_mask) + sizeof(bitboards::kchecks) +
+		sizeof(zobrist::piece_rands) + sizeof(zobrist::castle_rands) + sizeof(zobrist::ep_rands) +
+		sizeof(zobrist::cuckoo) + sizeof(material::table);
+	std::cout << "startup bench compile-time tables " << (static_bytes / 1024) << " kb" << std::endl;
+
+	std::string backend = (magics::backend() == magics::pext ? "pext" : "fancy");
+	tot_timer.start();
+	for (int i = 0; i < iterations; ++i)
+		magics::load(backend);
+	tot_timer.stop();
+	std::cout << "startup bench magics (" << magics::backend_name() << ") avg ms "
+		<< (tot_timer.ms() / iterations) << std::endl;
+
+	tot_timer.start();
+	for (int i = 0; i < iterations; ++i) {
+		hash_table tt;
+		tt.init();
+	}
+	tot_timer.stop();
+	std::cout << "startup bench hash table " << default_hash_mb << " mb (deferred to isready) avg ms "
+		<< (tot_timer.ms() / iterations) << std::endl;
+}
+
+/// <summary>
+/// Repetition detection over long shuffle-heavy endgames : random games from the endgames (16 men or less)
+/// of an epd file, playing reversible piece moves with an irreversible move every 90 plies so the game history gets deep.
+/// is_draw and has_upcoming_repetition are timed at every ply of every game.
+/// </summary>
+inline void Perft::rep_bench(const std::string& filename, const int& plies, const int& iterations) {
+
+	// unit positions : after the listed moves, can the side to move repeat the position of 3 plies ago in one move
+	struct rep_unit { std::string fen; std::vector<std::string> moves; bool expected; };
+	const std::vector<rep_unit> units = {
+		{ "6k1/8/8/8/8/8/8/1N4K1 w - - 0 1", { "g1h1", "g8h8", "b1c3", "h8g8" }, true }, // knight shuffle (c3b1)
+		{ "6k1/8/8/8/8/8/8/R5K1 w - - 0 1", { "g1h1", "g8h8", "a1a3", "h8g8" }, true }, // rook shuffle (a3a1)
+		{ "6k1/8/8/8/8/8/8/1N4K1 w - - 0 1", { "g1h1", "g8h8", "b1c3", "h8h7" }, false }, // the black king left g8 for good
+		{ "6k1/8/8/8/8/8/1P6/R5K1 w - - 0 1", { "g1h1", "g8h8", "a1b1", "h8g8", "b2b3" }, false } // pawn move resets the history
+	};
+	size_t unit_mismatches = 0;
+	for (const rep_unit& u : units) {
+		std::istringstream fen(u.fen);
+		position up(fen);
+		for (const std::string& mv : u.moves) {
+			Movegen mvs(up);
+			mvs.generate<pseudo_legal, pieces>();
+			for (int i = 0; i < mvs.size(); ++i) {
+				if (up.is_legal(mvs[i]) && SanSquares[mvs[i].f] + SanSquares[mvs[i].t] == mv) {
+					up.do_move(mvs[i]);
+					break;
+				}
+			}
+		}
+		unit_mismatches += (up.has_upcoming_repetition(64) != u.expected);
+	}
+	std::cout << "repetition bench unit positions mismatches " << unit_mismatches << "/" << units.size() << std::endl;
+
+	std::vector<std::string> fens;
+	epd positions(filename);
+	for (const epd_entry& e : positions.get_positions()) {
+		std::istringstream fen(e.pos);
+		position p(fen);
+		if (bits::count(p.all_pieces()) <= 16)
+			fens.push_back(e.pos);
+	}
+
+	if (fens.empty()) {
+		std::cout << "repetition bench: no endgame positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	const int max_plies = std::min(plies, 900); // the game history holds 1024 entries
+	util::rand<unsigned int> r;
+	double draw_ms = 0, upcoming_ms = 0;
+	U64 calls = 0, draws = 0, upcoming = 0, history_depth = 0;
+	std::vector<Move> reversible, irreversible;
+	position p;
+
+	for (const std::string& f : fens) {
+		std::istringstream fen(f);
+		p.setup(fen);
+		int since_reset = 0;
+
+		for (int ply = 0; ply < max_plies; ++ply) {
+
+			tot_timer.start();
+			for (int i = 0; i < iterations; ++i)
+				draws += p.is_draw();
+			tot_timer.stop();
+			draw_ms += tot_timer.ms();
+
+			tot_timer.start();
+			for (int i = 0; i < iterations; ++i)
+				upcoming += p.has_upcoming_repetition(max_plies);
+			tot_timer.stop();
+			upcoming_ms += tot_timer.ms();
+
+			calls += iterations;
+			history_depth += ply;
+
+			reversible.clear();
+			irreversible.clear();
+			Movegen mvs(p);
+			mvs.generate<pseudo_legal, pieces>();
+			for (int i = 0; i < mvs.size(); ++i) {
+				if (!p.is_legal(mvs[i])) continue;
+				bool reset = p.piece_on(Square(mvs[i].f)) == pawn || mvs[i].type != quiet;
+				(reset ? irreversible : reversible).push_back(mvs[i]);
+			}
+
+			const bool reset = !irreversible.empty() && (since_reset >= 90 || reversible.empty());
+			const std::vector<Move>& candidates = (reset ? irreversible : reversible);
+			if (candidates.empty())
+				break;
+
+			p.do_move(candidates[r.next() % candidates.size()]);
+			since_reset = (reset ? 0 : since_reset + 1);
+		}
+	}
+
+	const U64 positions_timed = calls / iterations;
+	std::cout << "repetition bench games " << fens.size()
+		<< " positions " << positions_timed
+		<< " avg history " << (double(history_depth) / positions_timed) << std::endl;
+	std::cout << "  is_draw                 ns/call " << (draw_ms * 1e6 / calls)
+		<< " draws " << (draws / iterations) << std::endl;
+	std::cout << "  has_upcoming_repetition ns/call " << (upcoming_ms * 1e6 / calls)
+		<< " found " << (upcoming / iterations) << std::endl;
+}
+
+/// <summary>
+/// Static exchange throughput over the legal captures and promotions of the positions in an epd file :
+/// the full exchange value (see_move) and the threshold test (see_ge) the search uses.
+/// see_ge is checked against see_move at a few thresholds.
+/// </summary>
+inline void Perft::see_bench(const std::string& filename, const int& iterations) {
+
+	std::vector<std::string> fens;
+	epd positions(filename);
+	for (const epd_entry& e : positions.get_positions())
+		fens.push_back(e.pos);
+
+	if (fens.empty()) {
+		std::cout << "see bench: no positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	const int thresholds[] = { -200, 0, 200 };
+	double value_ms = 0, threshold_ms = 0;
+	U64 moves = 0, mismatches = 0;
+	long long checksum = 0;
+	std::vector<Move> captures;
+	position p;
+
+	for (const std::string& f : fens) {
+		std::istringstream fen(f);
+		p.setup(fen);
+
+		captures.clear();
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size(); ++i) {
+			Movetype t = Movetype(mvs[i].type);
+			if ((t == quiet || t == castle_ks || t == castle_qs) || !p.is_legal(mvs[i])) continue;
+			captures.push_back(mvs[i]);
+		}
+		if (captures.empty())
+			continue;
+
+		for (const Move& m : captures) {
+			const int v = p.see_move(m);
+			for (const int& th : thresholds)
+				mismatches += (p.see_ge(m, v + th) != (th <= 0));
+		}
+
+		tot_timer.start();
+		for (int i = 0; i < iterations; ++i)
+			for (const Move& m : captures) checksum += p.see_move(m);
+		tot_timer.stop();
+		value_ms += tot_timer.ms();
+
+		tot_timer.start();
+		for (int i = 0; i < iterations; ++i)
+			for (const Move& m : captures) checksum += p.see_ge(m, 0);
+		tot_timer.stop();
+		threshold_ms += tot_timer.ms();
+
+		moves += captures.size();
+	}
+
+	const double calls = double(moves) * iterations;
+	std::cout << "see bench positions " << fens.size() << " captures " << moves
+		<< " checksum " << checksum << " mismatches " << mismatches << std::endl;
+	std::cout << "  see_move  Mcalls/s " << (calls / (value_ms * 1e3)) << " ns/call " << (value_ms * 1e6 / calls) << std::endl;
+	std::cout << "  see_ge(0) Mcalls/s " << (calls / (threshold_ms * 1e3)) << " ns/call " << (threshold_ms * 1e6 / calls) << std::endl;
+}
+
+
+/// <summary>
+/// Quiet check generation (generate<quiet_check, pieces>) against gives_check : at every node not in check
+/// of the trees 'plies' deep below the positions of an epd file (and a few fixed positions where a discovered
+/// check candidate moves along its own line), the generated moves must be exactly the quiet pseudo-legal
+/// moves for which gives_check is true.
+/// </summary>
+inline void Perft::check_gen(const std::string& filename, const int& plies) {
+
+	// a slider shielding another slider on its own line already attacks the king, so the first four
+	// leave the side not to move in check : they only exercise moves along the line that check directly
+	std::vector<std::string> fens = {
+		"4k3/8/8/8/4Q3/8/8/4RK2 w - - 0 1", // queen shielding a rook on a file (Qe5, Qe6, Qe7 check directly)
+		"4k3/8/8/8/4R3/8/8/4QK2 w - - 0 1", // rook shielding a queen on a file
+		"7k/8/8/8/3B4/8/8/Q5K1 w - - 0 1", // bishop shielding a queen on a diagonal
+		"7k/8/8/8/3Q4/8/8/B5K1 w - - 0 1", // queen shielding a bishop on a diagonal
+		"4k3/8/8/4P3/8/8/8/4RK2 w - - 0 1" // pawn shielding a rook, pushes stay on the line
+	};
+	const size_t unit_positions = fens.size();
+	epd positions(filename);
+	for (const epd_entry& e : positions.get_positions())
+		fens.push_back(e.pos);
+
+	U64 nodes = 0, checks = 0, mismatches = 0, unit_mismatches = 0;
+	position p;
+
+	std::function<void(const int&)> visit = [&](const int& depth) {
+		if (!p.in_check()) {
+			++nodes;
+			std::vector<U16> expected, generated;
+
+			Movegen all(p);
+			all.generate<pseudo_legal, pieces>();
+			for (int i = 0; i < all.size(); ++i) {
+				if (Movetype(all[i].type) == quiet && p.gives_check(all[i]))
+					expected.push_back(all[i].data());
+			}
+
+			Movegen qc(p);
+			qc.generate<quiet_check, pieces>();
+			for (int i = 0; i < qc.size(); ++i)
+				generated.push_back(qc[i].data());
+
+			std::sort(expected.begin(), expected.end());
+			std::sort(generated.begin(), generated.end());
+			checks += expected.size();
+			mismatches += (expected != generated);
+		}
+
+		if (depth <= 0)
+			return;
+
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size(); ++i) {
+			if (!p.is_legal(mvs[i]))
+				continue;
+			p.do_move(mvs[i]);
+			visit(depth - 1);
+			p.undo_move(mvs[i]);
+		}
+	};
+
+	for (size_t i = 0; i < fens.size(); ++i) {
+		std::istringstream fen(fens[i]);
+		p.setup(fen);
+		U64 before = mismatches;
+		visit(i < unit_positions ? 0 : plies);
+		if (i < unit_positions && mismatches != before) {
+			++unit_mismatches;
+			std::cout << "check gen mismatch in " << fens[i] << std::endl;
+		}
+	}
+
+	std::cout << "check gen positions " << fens.size() << " nodes " << nodes << " quiet checks " << checks
+		<< " mismatches " << mismatches << " (unit positions " << unit_mismatches << "/" << unit_positions << ")" << std::endl;
+}
+
+
+/// <summary>
+/// Syzygy probes against known results, one "fen ;wdl 2 ;dtz 19" line per position (dtz optional) probed with
+/// the tables of the SyzygyPath option. Positions whose tables are missing are skipped. The WDL result is also
+/// checked against the best result of the legal moves, a test that needs no known values.
+/// </summary>
+inline void Perft::tb_test(const std::string& filename) {
+
+	struct tb_case {
+		std::string fen;
+		int wdl = 0;
+		int dtz = 0;
+		bool has_dtz = false;
+	};
+
+	std::vector<tb_case> cases;
+	std::ifstream file(filename);
+	std::string line;
+	while (std::getline(file, line)) {
+		std::vector<std::string> tokens = util::split(line, ';');
+		if (tokens.size() < 2)
+			continue;
+
+		tb_case c;
+		c.fen = tokens[0];
+		bool has_wdl = false;
+		for (size_t i = 1; i < tokens.size(); ++i) {
+			std::istringstream ts(tokens[i]);
+			std::string k;
+			int v = 0;
+			if (!(ts >> k >> v)) continue;
+			if (k == "wdl") { c.wdl = v; has_wdl = true; }
+			else if (k == "dtz") { c.dtz = v; c.has_dtz = true; }
+		}
+		if (has_wdl) cases.push_back(c);
+	}
+
+	if (cases.empty()) {
+		std::cout << "tb test: no positions loaded from " << filename << std::endl;
+		return;
+	}
+
+	auto sign = [](const int& v) { return (v > 0) - (v < 0); };
+	U64 probed = 0, skipped = 0, wdl_mismatches = 0, dtz_mismatches = 0, move_mismatches = 0;
+	position p;
+
+	for (const tb_case& c : cases) {
+		std::istringstream fen(c.fen);
+		p.setup(fen);
+
+		bool wdl_ok = false, dtz_ok = false;
+		const int wdl = (syzygy::covers(p) ? syzygy::probe_wdl(p, wdl_ok) : 0);
+		if (!wdl_ok) {
+			++skipped;
+			continue;
+		}
+		++probed;
+		const int dtz = (c.has_dtz ? syzygy::probe_dtz(p, dtz_ok) : 0);
+
+		bool mismatch = (wdl != c.wdl);
+		wdl_mismatches += (wdl != c.wdl);
+		if (c.has_dtz && dtz_ok && dtz != c.dtz) {
+			mismatch = true;
+			++dtz_mismatches;
+		}
+
+		// the best child result from the side to move, mated or stalemated without legal moves
+		int best = -2;
+		bool children_ok = true, moves = false;
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size() && children_ok; ++i) {
+			if (!p.is_legal(mvs[i]))
+				continue;
+			moves = true;
+			p.do_move(mvs[i]);
+			bool ok = false;
+			const int v = -syzygy::probe_wdl(p, ok);
+			p.undo_move(mvs[i]);
+			children_ok = ok;
+			best = std::max(best, v);
+		}
+		if (!moves)
+			best = (p.in_check() ? -2 : 0);
+		if (children_ok && sign(best) != sign(wdl)) {
+			mismatch = true;
+			++move_mismatches;
+		}
+
+		if (mismatch)
+			std::cout << "tb test mismatch " << c.fen << " expected wdl " << c.wdl << " dtz " << (c.has_dtz ? std::to_string(c.dtz) : "-")
+				<< " probed wdl " << wdl << " dtz " << (dtz_ok ? std::to_string(dtz) : "-") << " best move wdl " << best << std::endl;
+	}
+
+	std::cout << "tb test positions " << cases.size() << " probed " << probed << " skipped " << skipped
+		<< " wdl mismatches " << wdl_mismatches << " dtz mismatches " << dtz_mismatches
+		<< " move mismatches " << move_mismatches << std::endl;
+}
+
 #endif
@@ -0,0 +1,149 @@
+#include <bitset>
+
+#include "bitbase.h"
+#include "bitboards.h"
+#include "magics.h"
+#include "position.h"
+
+
+namespace {
+
+	// one bit per (pawn square a2-h7, side to move, white king, black king), set when white wins
+	const unsigned pawn_squares = 48;
+	const unsigned table_size = pawn_squares * colors * squares * squares;
+
+	std::bitset<table_size> kpk_wins;
+
+	inline unsigned slot(const int& wp, const Color& stm, const int& wks, const int& bks) {
+		return ((unsigned(wp - 8) * colors + stm) * squares + wks) * squares + bks;
+	}
+
+	inline U64 sq(const int& s) { return bitboards::squares[s]; }
+
+	// a placement is legal when the three men stand on different squares, the kings are not
+	// in contact and black is not in check with white to move
+	bool legal(const int& wp, const Color& stm, const int& wks, const int& bks) {
+		if (wks == bks || wks == wp || bks == wp)
+			return false;
+		if (bitboards::kmask[wks] & sq(bks))
+			return false;
+		return !(stm == white && (bitboards::pattks[white][wp] & sq(bks)));
+	}
+
+	// the pawn promotes to 'p' with black to move : king and queen (or rook) against king is won
+	// unless black takes the new piece at once or has no move without being in check
+	bool promotion_wins(const Piece& p, const int& wks, const int& bks, const int& to) {
+		const U64 guarded = bitboards::kmask[wks];
+		if ((bitboards::kmask[bks] & sq(to)) && !(guarded & sq(to)))
+			return false;
+
+		// slider attacks with the black king lifted off the board (it can't hide behind itself)
+		const U64 occ = sq(wks) | sq(to);
+		U64 covered = guarded | magics::attacks<rook>(occ, Square(to));
+		if (p == queen)
+			covered |= magics::attacks<bishop>(occ, Square(to));
+
+		const bool in_check = (covered & sq(bks)) != 0ULL;
+		const bool can_move = (bitboards::kmask[bks] & ~covered) != 0ULL;
+		return in_check || can_move;
+	}
+
+	bool white_wins(const int& wp, const int& wks, const int& bks) {
+		const int push = wp + 8;
+		const bool blocked = (push == wks || push == bks);
+
+		if (!blocked) {
+			if (util::row(wp) == Row::r7) {
+				if (promotion_wins(queen, wks, bks, push) || promotion_wins(rook, wks, bks, push))
+					return true;
+			}
+			else {
+				if (kpk_wins[slot(push, black, wks, bks)])
+					return true;
+				const int jump = wp + 16;
+				if (util::row(wp) == Row::r2 && jump != wks && jump != bks &&
+					kpk_wins[slot(jump, black, wks, bks)])
+					return true;
+			}
+		}
+
+		U64 steps = bitboards::kmask[wks] & ~(bitboards::kmask[bks] | sq(bks) | sq(wp));
+		while (steps) {
+			const int to = bits::pop_lsb(steps);
+			if (kpk_wins[slot(wp, black, to, bks)])
+				return true;
+		}
+		return false;
+	}
+
+	bool black_loses(const int& wp, const int& wks, const int& bks) {
+		const U64 pawn_cover = bitboards::pattks[white][wp];
+		U64 steps = bitboards::kmask[bks] & ~(bitboards::kmask[wks] | pawn_cover | sq(wks));
+
+		// taking the undefended pawn leaves two bare kings
+		if (steps & sq(wp))
+			return false;
+
+		// no move at all : mated by the pawn, or stalemate
+		if (steps == 0ULL)
+			return (pawn_cover & sq(bks)) != 0ULL;
+
+		while (steps) {
+			const int to = bits::pop_lsb(steps);
+			if (!kpk_wins[slot(wp, white, wks, to)])
+				return false;
+		}
+		return true;
+	}
+
+	// positions with the pawn on 'wp' only lead to each other or to positions with the pawn further
+	// up the board, so each pawn square is solved on its own once the squares in front are done
+	void solve(const int& wp) {
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			for (int wks = 0; wks < squares; ++wks) {
+				for (int bks = 0; bks < squares; ++bks) {
+					for (Color stm : { white, black }) {
+						const unsigned i = slot(wp, stm, wks, bks);
+						if (kpk_wins[i] || !legal(wp, stm, wks, bks))
+							continue;
+						if (stm == white ? white_wins(wp, wks, bks) : black_loses(wp, wks, bks)) {
+							kpk_wins.set(i);
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+void bitbase::init() {
+	kpk_wins.reset();
+	for (int r = Row::r7; r >= Row::r2; --r) {
+		for (int c = Col::A; c <= Col::H; ++c)
+			solve(r * 8 + c);
+	}
+}
+
+bool bitbase::probe_kpk(const Square& wks, const Square& wp, const Square& bks, const Color& stm) {
+	return kpk_wins[slot(wp, stm, wks, bks)];
+}
+
+int bitbase::probe(const position& p) {
+	const Color strong = (p.get_pieces<white, pawn>() != 0ULL ? white : black);
+	const Color weak = Color(strong ^ 1);
+
+	// the table is built for a white pawn, a black pawn is seen through the board flipped vertically
+	const int flip = (strong == white ? 0 : 56);
+	const int wks = p.king_square(strong) ^ flip;
+	const int bks = p.king_square(weak) ^ flip;
+	const int wp = (strong == white ? p.square_of<white, pawn>() : p.square_of<black, pawn>()) ^ flip;
+
+	const Color stm = (p.to_move() == strong ? white : black);
+	if (!probe_kpk(Square(wks), Square(wp), Square(bks), stm))
+		return 0;
+	return (p.to_move() == strong ? 1 : -1);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include "types.h"
+
+class position;
+
+/// <summary>
+/// Built-in king and pawn vs king bitbase, solved at startup one pawn square at a time (7th rank first).
+/// It needs no tablebase files and covers only this ending, the syzygy tables are probed separately (syzygy.h).
+/// Positions are seen with the pawn side as white, a set bit is a win for white (every other legal position is a draw).
+/// </summary>
+namespace bitbase {
+
+	void init();
+	bool probe_kpk(const Square& wks, const Square& wp, const Square& bks, const Color& stm);
+
+	// KPK positions only (two kings and one pawn) : 1 side to move wins, 0 draw, -1 side to move loses
+	int probe(const position& p);
+}
+
+#endif
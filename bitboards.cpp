@@ -1,206 +1,223 @@
+#include <bit>
 
 #include "bitboards.h"
-#include "bits.h"
 
-namespace bitboards {
-	U64 row[8];
-	U64 col[8];
-	U64 bmask[64]; // bishop mask (outer board edges are trimmed)
-	U64 pawnmask[2]; // 2nd - 6th rank mask for pawns (to exclude promotion candidates)
-	U64 pattks[2][64];
-	U64 pawnmaskleft[2];
-	U64 pawnmaskright[2];
-	U64 nmask[64]; // step attacks for the knight
-	U64 kmask[64]; // step attacks for the king
-	U64 kchecks[5][64]; // check mask for king
-	U64 kzone[64]; // large zone around king (for eval)
-	U64 kflanks[8]; // 3 rows of squares (including king square) for pawn cover detection
-	U64 rmask[64]; // rook mask (outer board edges are trimmed)
-	U64 kpawnstorm[2][2]; // to detect enemy pawn storms against our king
-	U64 battks[64];
-	U64 rattks[64];
-	U64 small_center_mask;
-	U64 big_center_mask;
-	U64 squares[64];
-	U64 diagonals[64];
-	U64 between[64][64];
-	U64 passpawn_mask[2][64];
-	U64 neighbor_cols[8];
-	U64 colored_sqs[2];
-	U64 front_region[2][64];
-	U64 pawn_majority_masks[3]; // 1 for each flank
-	unsigned reductions[2][2][64][64]; // max-depth = 64
-	U64 edges;
-	U64 corners;
-}
+namespace {
+
+	typedef std::array<U64, 64> sqtable;
+
+	/// <summary>
+	/// Natural log usable in constant expressions (std::log is not constexpr),
+	/// x = m * 2^k with m in [0.75, 1.5), ln(m) = 2 * atanh((m - 1) / (m + 1)).
+	/// </summary>
+	constexpr double ln(double x) {
+		constexpr double ln2 = 0.693147180559945309417232121458;
+		int k = 0;
+		while (x >= 1.5) { x /= 2.0; ++k; }
+		while (x < 0.75) { x *= 2.0; --k; }
+		double y = (x - 1.0) / (x + 1.0);
+		double y2 = y * y;
+		double term = y;
+		double sum = 0.0;
+		for (int n = 1; n < 60; n += 2) {
+			sum += term / n;
+			term *= y2;
+		}
+		return 2.0 * sum + k * ln2;
+	}
 
-void bitboards::load() {
+	constexpr U64 square(const int& s) { return 1ULL << s; }
 
-	std::vector<std::vector<int>> steps =
-	{
-		{ }, // pawn 
-		{ 10, -6, -10, 6, 17, 15, -15, -17}, // knight
-		{ -7, -9, 7, 9 }, // bishop
-		{ -1, 1, 8, -8 }, // rook
-		{ }, // queen
-		{ -1, 1, 8, -8, -9, -7, 9, 7 }  // king
-	};
+	constexpr U64 step_mask(const int& s, const int* steps, const int& nsteps, const int& max_dist) {
+		U64 bm = 0ULL;
+		for (int i = 0; i < nsteps; ++i) {
+			int to = s + steps[i];
+			if (util::on_board(to) &&
+				util::col_dist(s, to) <= max_dist &&
+				util::row_dist(s, to) <= max_dist) bm |= square(to);
+		}
+		return bm;
+	}
+
+	constexpr int knight_steps[] = { 10, -6, -10, 6, 17, 15, -15, -17 };
+	constexpr int bishop_steps[] = { -7, -9, 7, 9 };
+	constexpr int king_steps[] = { -1, 1, 8, -8, -9, -7, 9, 7 };
 
 	// king zone steps
-	std::vector<int> zsteps = {
+	constexpr int zone_steps[] = {
 		-1, 1, 8, -8, -9, -7, 9, 7, // normal kmask
 		-2, 2, -2 + 8, -2 - 8, 2 + 8, 2 - 8, -2 - 16, -2 + 16, 2 - 16, 2 + 16,
 		-16, 16, -16 - 1, -16 + 1, 16 + 1, 16 - 1
 	};
+}
 
-	for (Square s = A1; s <= H8; ++s) squares[s] = (1ULL << s);
-
-	// row/col masks
-	for (Row r = r1; r <= r8; ++r) {
-		U64 rw = 0ULL; U64 cl = 0ULL;
-		for (Col c = A; c <= H; ++c) {
-			cl |= squares[c * 8 + r];
-			rw |= squares[r * 8 + c];
-		}
-		row[r] = rw;
-		col[r] = cl;
-	}
+namespace bitboards {
 
+	constexpr std::array<U64, 64> squares = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s) t[s] = square(s);
+		return t;
+	}();
 
-	// pawn majority masks
-	pawn_majority_masks[0] = col[Col::A] | col[Col::B] | col[Col::C];
-	pawn_majority_masks[1] = col[Col::D] | col[Col::E];
-	pawn_majority_masks[2] = col[Col::F] | col[Col::G] | col[Col::H];
+	// row/col masks
+	constexpr std::array<U64, 8> row = [] {
+		std::array<U64, 8> t{};
+		for (int r = r1; r <= r8; ++r)
+			for (int c = A; c <= H; ++c) t[r] |= squares[r * 8 + c];
+		return t;
+	}();
+
+	constexpr std::array<U64, 8> col = [] {
+		std::array<U64, 8> t{};
+		for (int c = A; c <= H; ++c)
+			for (int r = r1; r <= r8; ++r) t[c] |= squares[r * 8 + c];
+		return t;
+	}();
+
+	// pawn majority masks (1 for each flank)
+	constexpr std::array<U64, 3> pawn_majority_masks = {
+		col[Col::A] | col[Col::B] | col[Col::C],
+		col[Col::D] | col[Col::E],
+		col[Col::F] | col[Col::G] | col[Col::H]
+	};
 
 	// helpful definitions for board corners/edges
-	edges = row[r1] | col[A] | row[r8] | col[H];
-	corners = squares[A1] | squares[H1] | squares[H8] | squares[A8];
+	constexpr U64 edges = row[r1] | col[A] | row[r8] | col[H];
+	constexpr U64 corners = squares[A1] | squares[H1] | squares[H8] | squares[A8];
 
 	// pawn masks for captures/promotions
-	pawnmask[white] = row[r2] | row[r3] | row[r4] | row[r5] | row[r6];
-	pawnmask[black] = row[r3] | row[r4] | row[r5] | row[r6] | row[r7];
-	for (Color color = white; color <= black; ++color) {
-		pawnmaskleft[color] = 0ULL;
-		pawnmaskright[color] = 0ULL;
-		for (int r = (color == white ? 1 : 2); r <= (color == white ? 5 : 6); ++r) {
-			for (int c = 0; c <= 6; ++c) pawnmaskleft[color] |= squares[r * 8 + c];
-			for (int c = 1; c <= 7; ++c) pawnmaskright[color] |= squares[r * 8 + c];
-		}
-	}
+	constexpr std::array<U64, 2> pawnmask = {
+		row[r2] | row[r3] | row[r4] | row[r5] | row[r6],
+		row[r3] | row[r4] | row[r5] | row[r6] | row[r7]
+	};
+
+	constexpr std::array<U64, 2> pawnmaskleft = [] {
+		std::array<U64, 2> t{};
+		for (int color = white; color <= black; ++color)
+			for (int r = (color == white ? 1 : 2); r <= (color == white ? 5 : 6); ++r)
+				for (int c = 0; c <= 6; ++c) t[color] |= squares[r * 8 + c];
+		return t;
+	}();
+
+	constexpr std::array<U64, 2> pawnmaskright = [] {
+		std::array<U64, 2> t{};
+		for (int color = white; color <= black; ++color)
+			for (int r = (color == white ? 1 : 2); r <= (color == white ? 5 : 6); ++r)
+				for (int c = 1; c <= 7; ++c) t[color] |= squares[r * 8 + c];
+		return t;
+	}();
 
 	// central control masks
-	big_center_mask = squares[C3] | squares[D3] | squares[E3] | squares[F3] |
+	constexpr U64 big_center_mask = squares[C3] | squares[D3] | squares[E3] | squares[F3] |
 		squares[C4] | squares[D4] | squares[E4] | squares[F4] |
 		squares[C5] | squares[D5] | squares[E5] | squares[F5] |
 		squares[C6] | squares[D6] | squares[E6] | squares[F6];
 
-	small_center_mask = squares[C4] | squares[C5] | squares[D4] | squares[D5] | squares[E4] | squares[E5];
+	constexpr U64 small_center_mask = squares[C4] | squares[C5] | squares[D4] | squares[D5] | squares[E4] | squares[E5];
 
 	// king flank masks
-	U64 roi = ~(row[0] | row[7]);
-	for (Col c = Col::A; c <= Col::H; ++c) {
-		kflanks[c] = 0ULL;
-
-		int lidx = (c - 1 < 0 ? 0 : c - 1);
-		int ridx = (c + 1 > Col::H ? Col::H : c + 1);
-
-		U64 mask = c <= Col::C || c >= Col::F ?
-			(col[lidx] | col[c] | col[ridx])
-			: (col[lidx - 1] | col[lidx] | col[c] | col[ridx] | col[ridx + 1]);
-
-		kflanks[c] |= roi & mask;
-
-	}
+	constexpr std::array<U64, 8> kflanks = [] {
+		std::array<U64, 8> t{};
+		U64 roi = ~(row[0] | row[7]);
+		for (int c = Col::A; c <= Col::H; ++c) {
+			int lidx = (c - 1 < 0 ? 0 : c - 1);
+			int ridx = (c + 1 > Col::H ? Col::H : c + 1);
 
-	for (Square s = A1; s <= H8; ++s) {
+			U64 mask = c <= Col::C || c >= Col::F ?
+				(col[lidx] | col[c] | col[ridx])
+				: (col[lidx - 1] | col[lidx] | col[c] | col[ridx] | col[ridx + 1]);
 
-		if ((util::row(s) % 2 == 0) && (s % 2 == 0)) 
-			colored_sqs[black] |= squares[s];
-		else if ((util::row(s) % 2) != 0 && (s % 2 != 0)) 
-			colored_sqs[black] |= squares[s];
-		else 
-			colored_sqs[white] |= squares[s];
+			t[c] = roi & mask;
+		}
+		return t;
+	}();
+
+	constexpr std::array<U64, 2> colored_sqs = [] {
+		std::array<U64, 2> t{};
+		for (int s = A1; s <= H8; ++s) {
+			if ((util::row(s) % 2 == 0) && (s % 2 == 0))
+				t[black] |= squares[s];
+			else if ((util::row(s) % 2) != 0 && (s % 2 != 0))
+				t[black] |= squares[s];
+			else
+				t[white] |= squares[s];
+		}
+		return t;
+	}();
 
+	// search reduction array
+	// index assignment [pv_node][improving][depth][move count]
+	constexpr std::array<std::array<std::array<std::array<unsigned, 64>, 64>, 2>, 2> reductions = [] {
+		std::array<std::array<std::array<std::array<unsigned, 64>, 64>, 2>, 2> t{};
+		std::array<double, 64> logs{};
+		for (int i = 0; i < 64; ++i) logs[i] = ln(double(i + 1));
 
-		// search reduction array
-		// index assignment [pv_node][improving][depth][move count]
 		for (int sd = 0; sd < 64; ++sd) {
 			for (int mc = 0; mc < 64; ++mc) {
-				// pv nodes
-				double small_r = log(double(sd + 1)) * log(double(mc + 1)) / 2.0;
-				double big_r = 0.25 + log(double(sd + 1)) * log(double(mc + 1)) / 1.5;
+				double small_r = logs[sd] * logs[mc] / 2.0;
+				double big_r = 0.25 + logs[sd] * logs[mc] / 1.5;
 
 				// pv-nodes
-				reductions[1][0][sd][mc] = int(big_r >= 1.0 ? big_r + 0.5 : 0);
-				reductions[1][1][sd][mc] = int(small_r >= 1.0 ? small_r + 0.5 : 0);
+				t[1][0][sd][mc] = unsigned(big_r >= 1.0 ? big_r + 0.5 : 0);
+				t[1][1][sd][mc] = unsigned(small_r >= 1.0 ? small_r + 0.5 : 0);
 
 				// non-pv nodes
-				reductions[0][0][sd][mc] = reductions[1][0][sd][mc] + 1;
-				reductions[0][1][sd][mc] = reductions[1][1][sd][mc] + 1;
+				t[0][0][sd][mc] = t[1][0][sd][mc] + 1;
+				t[0][1][sd][mc] = t[1][1][sd][mc] + 1;
 			}
 		}
-
-		// knight step attacks
-		U64 bm = 0ULL;
-		for (auto& step : steps[Piece::knight]) {
-			int to = s + step;
-			if (util::on_board(to) &&
-				util::col_dist(s, to) <= 2 &&
-				util::row_dist(s, to) <= 2) bm |= squares[to];
-		}
-		nmask[s] = bm;
-
-		// king step attacks
-		bm = 0ULL;
-		for (auto& step : steps[Piece::king]) {
-			int to = s + step;
-			if (util::on_board(to) &&
-				util::col_dist(s, to) <= 1 &&
-				util::row_dist(s, to) <= 1) bm |= squares[to];
+		return t;
+	}();
+
+	// knight step attacks
+	constexpr std::array<U64, 64> nmask = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s) t[s] = step_mask(s, knight_steps, 8, 2);
+		return t;
+	}();
+
+	// king step attacks
+	constexpr std::array<U64, 64> kmask = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s) t[s] = step_mask(s, king_steps, 8, 1);
+		return t;
+	}();
+
+	// king zone bitboard (for eval)
+	constexpr std::array<U64, 64> kzone = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s) t[s] = step_mask(s, zone_steps, 24, 2);
+		return t;
+	}();
+
+	// pawn attack masks for each color
+	constexpr std::array<std::array<U64, 64>, 2> pattks = [] {
+		constexpr int pawn_steps[2][2] = { {9, 7}, {-7, -9} };
+		std::array<sqtable, 2> t{};
+		for (int c = white; c <= black; ++c)
+			for (int s = A1; s <= H8; ++s) t[c][s] = step_mask(s, pawn_steps[c], 2, 1);
+		return t;
+	}();
+
+	// front region for each square
+	constexpr std::array<std::array<U64, 64>, 2> front_region = [] {
+		std::array<sqtable, 2> t{};
+		for (int s = A1; s <= H8; ++s) {
+			for (int r = util::row(s) + 1; r <= Row::r8; ++r) t[white][s] |= row[r];
+			for (int r = util::row(s) - 1; r >= Row::r1; --r) t[black][s] |= row[r];
 		}
-		kmask[s] = bm;
+		return t;
+	}();
 
-		// king zone bitboard (for eval)
-		bm = 0ULL;
-		for (auto& step : zsteps) {
-			int to = s + step;
-			if (util::on_board(to) &&
-				util::col_dist(s, to) <= 2 &&
-				util::row_dist(s, to) <= 2) bm |= squares[to];
-		}
-		kzone[s] = bm;
-
-		// pawn attack masks for each color
-		int pawn_steps[2][2] = { {9, 7}, {-7, -9} };
-		for (Color c = white; c <= black; ++c) {
-			pattks[c][s] = 0ULL;
-			for (auto& step : pawn_steps[c]) {
-				int to = s + step;
-				if (util::on_board(to) &&
-					util::row_dist(s, to) < 2 &&
-					util::col_dist(s, to) < 2) {
-					pattks[c][s] |= squares[to];
-				}
-			}
-		}
+	// between bitboard
+	constexpr std::array<std::array<U64, 64>, 64> between = [] {
+		std::array<sqtable, 64> t{};
+		for (int s = A1; s <= H8; ++s) {
+			for (int s2 = A1; s2 <= H8; ++s2) {
+				if (s == s2)
+					continue;
 
-		// front region for each square
-		for (Color c = white; c <= black; ++c) {
-			front_region[c][s] = 0ULL;
-			if (c == white)
-				for (auto r = util::row(s) + 1; r <= Row::r8; ++r) 
-					front_region[c][s] |= bitboards::row[r];
-			else 
-				for (auto r = util::row(s) - 1; r >= Row::r1; --r)
-					front_region[c][s] |= bitboards::row[r];
-		}
-
-		// between bitboard
-		for (Square s2 = A1; s2 <= H8; ++s2) {
-			if (s != s2) {
-				U64 btwn = 0ULL;
 				int delta = 0;
-
 				if (util::col_dist(s, s2) == 0) delta = (s < s2 ? 8 : -8);
 				else if (util::row_dist(s, s2) == 0) delta = (s < s2 ? 1 : -1);
 				else if (util::on_diagonal(s, s2)) {
@@ -211,88 +228,101 @@ void bitboards::load() {
 				}
 
 				if (delta != 0) {
-					int iter = 0;
-					int sq = 0;
-					do {
-						sq = s + iter * delta;
-						btwn |= squares[sq];
-						iter++;
-					} while (sq != s2);
+					U64 btwn = 0ULL;
+					int sq = s;
+					for (; sq != s2; sq += delta) btwn |= squares[sq];
+					t[s][s2] = btwn | squares[s2];
 				}
-				between[s][s2] = btwn;
 			}
 		}
+		return t;
+	}();
 
-
-		// passed pawn masks
+	// passed pawn masks
+	constexpr std::array<std::array<U64, 64>, 2> passpawn_mask = [] {
+		std::array<sqtable, 2> t{};
 		U64 roi = ~(row[0] | row[7]);
-		if (squares[s] & roi) {
-
-			neighbor_cols[util::col(s)] = 0ULL;
-
-			for (Color c = white; c <= black; ++c) {
-				passpawn_mask[c][s] = 0ULL;
-
-				U64 neighbors =
-					(kmask[s] & row[util::row(s)]) | squares[s];
-
+		for (int s = A1; s <= H8; ++s) {
+			if (!(squares[s] & roi))
+				continue;
+			for (int c = white; c <= black; ++c) {
+				U64 neighbors = (kmask[s] & row[util::row(s)]) | squares[s];
 				while (neighbors) {
-					int sq = bits::pop_lsb(neighbors);
-					passpawn_mask[c][s] |=
-						util::squares_infront(col[util::col(sq)], c, sq);
-					if (s != sq)
-						neighbor_cols[util::col(s)] |= col[util::col(sq)];
+					int sq = std::countr_zero(neighbors);
+					neighbors &= neighbors - 1;
+					t[c][s] |= util::squares_infront(col[util::col(sq)], Color(c), sq);
 				}
 			}
 		}
-
-		// bishop diagonal masks (outer bits trimmed)
-		bm = 0ULL;
-		U64 trim = 0ULL;
-		for (auto& step : steps[Piece::bishop]) {
-			int j = 0;
-			while (true) {
-				int to = s + (j++) * step;
-				if (util::on_board(to) && util::on_diagonal(s, to)) bm |= squares[to];
-				else break;
+		return t;
+	}();
+
+	constexpr std::array<U64, 8> neighbor_cols = [] {
+		std::array<U64, 8> t{};
+		for (int c = Col::A; c <= Col::H; ++c) {
+			if (c > Col::A) t[c] |= col[c - 1];
+			if (c < Col::H) t[c] |= col[c + 1];
+		}
+		return t;
+	}();
+
+	// bishop diagonal masks (including the bishop square)
+	constexpr std::array<U64, 64> battks = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s) {
+			for (int step : bishop_steps) {
+				for (int j = 0; ; ++j) {
+					int to = s + j * step;
+					if (util::on_board(to) && util::on_diagonal(s, to)) t[s] |= squares[to];
+					else break;
+				}
 			}
 		}
-		trim = squares[s] | (bm & edges);
-		battks[s] = bm;
-		bm ^= trim;
-		bmask[s] = bm;
-
-		// rook masks (outer-bits trimmed)
-		bm = (row[util::row(s)] | col[util::col(s)]);
-		rattks[s] = bm;
-		trim = squares[s] | squares[8 * util::row(s)] | squares[8 * util::row(s) + 7] |
-			squares[util::col(s)] | squares[util::col(s) + 56];
-		bm ^= trim;
-		rmask[s] = bm;
-
-
-		// king check mask
-		kchecks[knight][s] = nmask[s];
-		kchecks[bishop][s] = battks[s];
-		kchecks[rook][s] = rattks[s];
-		kchecks[queen][s] = battks[s] | rattks[s];
-	}
+		return t;
+	}();
+
+	// bishop masks (outer bits trimmed)
+	constexpr std::array<U64, 64> bmask = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s)
+			t[s] = battks[s] ^ (squares[s] | (battks[s] & edges));
+		return t;
+	}();
+
+	// rook row/col masks (including the rook square)
+	constexpr std::array<U64, 64> rattks = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s)
+			t[s] = row[util::row(s)] | col[util::col(s)];
+		return t;
+	}();
+
+	// rook masks (outer-bits trimmed)
+	constexpr std::array<U64, 64> rmask = [] {
+		sqtable t{};
+		for (int s = A1; s <= H8; ++s)
+			t[s] = rattks[s] ^ (squares[s] | squares[8 * util::row(s)] | squares[8 * util::row(s) + 7] |
+				squares[util::col(s)] | squares[util::col(s) + 56]);
+		return t;
+	}();
+
+	// king check mask
+	constexpr std::array<std::array<U64, 64>, 5> kchecks = [] {
+		std::array<sqtable, 5> t{};
+		for (int s = A1; s <= H8; ++s) {
+			t[knight][s] = nmask[s];
+			t[bishop][s] = battks[s];
+			t[rook][s] = rattks[s];
+			t[queen][s] = battks[s] | rattks[s];
+		}
+		return t;
+	}();
 
 	// King pawn storm detection
-	kpawnstorm[white][0] = between[Square::F2][Square::F5] |
-		between[Square::G2][Square::G5] |
-		between[Square::H2][Square::H5];
-	kpawnstorm[white][1] = 
-		between[Square::A2][Square::A5] |
-		between[Square::B2][Square::B5] |
-		between[Square::C2][Square::C5];
-
-	kpawnstorm[black][0] = between[Square::F7][Square::F4] |
-		between[Square::G7][Square::G4] |
-		between[Square::H7][Square::H4];
-	kpawnstorm[black][1] =
-		between[Square::A7][Square::A4] |
-		between[Square::B7][Square::B4] |
-		between[Square::C7][Square::C4];
+	constexpr std::array<std::array<U64, 2>, 2> kpawnstorm = { {
+		{ between[F2][F5] | between[G2][G5] | between[H2][H5],
+		  between[A2][A5] | between[B2][B5] | between[C2][C5] },
+		{ between[F7][F4] | between[G7][G4] | between[H7][H4],
+		  between[A7][A4] | between[B7][B4] | between[C7][C4] }
+	} };
 }
-
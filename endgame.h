@@ -172,13 +172,13 @@ namespace eval {
 		auto kingOn7th = (c == white ? row_ks == Row::r7 : row_ks == Row::r2);
 		auto kingOn8th = (c == white ? row_ks == Row::r8 : row_ks == Row::r1);
 
-		Square frs = p.squares_of<c, rook>()[0];
+		Square frs = p.square_of<c, rook>();
 		int col_fr = util::col(frs);
 		int row_fr = util::row(frs);
 
 		Square ers = (c == white ?
-			p.squares_of<black, rook>()[0] :
-			p.squares_of<white, rook>()[0]);
+			p.square_of<black, rook>() :
+			p.square_of<white, rook>());
 		int col_er = util::col(ers);
 		int row_er = util::row(ers);
 
@@ -276,8 +276,8 @@ namespace eval {
 		int col = util::col(f);
 		Square frontSquare = Square(c == white ? f + 8 : f - 8);
 		Square bishopSquare = (c == white ?
-			p.squares_of<white, bishop>()[0] :
-			p.squares_of<black, bishop>()[0]);
+			p.square_of<white, bishop>() :
+			p.square_of<black, bishop>());
 		auto hasBishop = bishopSquare != Square::no_square;
 
 		// 1. Do our minors control the next square
@@ -304,7 +304,7 @@ namespace eval {
 
 			// 4. If knight blockades pawn and we cannot attack the knight
 			auto frontSquareLight = ((bitboards::squares[frontSquare] & bitboards::colored_sqs[white]) != 0ULL);
-			Square knightSquare = (c == white ? p.squares_of<black, knight>()[0] : p.squares_of<white, knight>()[0]);
+			Square knightSquare = (c == white ? p.square_of<black, knight>() : p.square_of<white, knight>());
 			if (knightSquare == frontSquare) {
 				//std::cout << "DBG: knight blockade penalty 1" << std::endl;
 				score -= blockade_penalty;
@@ -0,0 +1,42 @@
+
+#include <algorithm>
+#include <cstring>
+
+#include "evalcache.h"
+
+
+inline size_t pow2(size_t x) {
+	return x <= 2 ? x : pow2(x >> 1) << 1;
+}
+
+eval_table::eval_table() : sz_kb(0), count(0) {
+	init();
+}
+
+eval_table::eval_table(const eval_table& o) {
+	*this = o;
+}
+
+eval_table& eval_table::operator=(const eval_table& o) {
+	sz_kb = o.sz_kb;
+	count = o.count;
+	entries = std::unique_ptr<eval_entry[]>(new eval_entry[count]());
+	std::memcpy(entries.get(), o.entries.get(), count * sizeof(eval_entry));
+	probes = o.probes;
+	hits = o.hits;
+	return *this;
+}
+
+void eval_table::init() {
+	sz_kb = 1024; // 64k entries
+	count = 1024 * sz_kb / sizeof(eval_entry);
+	count = pow2(count);
+	count = (count < 1024 ? 1024 : count);
+	entries = std::unique_ptr<eval_entry[]>(new eval_entry[count]());
+	clear();
+}
+
+void eval_table::clear() {
+	std::fill(entries.get(), entries.get() + count, eval_entry());
+	clear_stats();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include <memory>
+
+#include "types.h"
+
+struct eval_entry {
+	eval_entry() : key(0ULL), score(0) { }
+
+	U64 key;
+	float score;
+};
+
+
+/// <summary>
+/// Small direct-mapped cache of full static evaluations (one per search thread).
+/// Entries are keyed by the complete zobrist key, lazy (early-exit) evaluations are never stored.
+/// </summary>
+class eval_table {
+private:
+	size_t sz_kb = 0;
+	size_t count = 0;
+	std::unique_ptr<eval_entry[]> entries;
+	mutable U64 probes = 0;
+	mutable U64 hits = 0;
+
+	void init();
+
+public:
+	eval_table();
+	eval_table(const eval_table& o);
+	eval_table& operator=(const eval_table& o);
+	~eval_table() {}
+
+	void clear();
+	void clear_stats() { probes = hits = 0; }
+
+	inline bool fetch(const U64& key, float& score) const;
+	inline void save(const U64& key, const float& score) const;
+
+	U64 probe_count() const { return probes; }
+	U64 hit_count() const { return hits; }
+};
+
+
+inline bool eval_table::fetch(const U64& key, float& score) const {
+	++probes;
+	const eval_entry& e = entries[key & (count - 1)];
+	if (e.key != key)
+		return false;
+	++hits;
+	score = e.score;
+	return true;
+}
+
+inline void eval_table::save(const U64& key, const float& score) const {
+	eval_entry& e = entries[key & (count - 1)];
+	e.key = key;
+	e.score = score;
+}
+
+#endif
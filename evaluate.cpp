@@ -1,11 +1,15 @@
 
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <sstream>
+#include <cassert>
 
 #include "evaluate.h"
 #include "squares.h"
 #include "magics.h"
 #include "endgame.h"
+#include "bitbase.h"
 #include "position.h"
 
 namespace eval {
@@ -16,7 +20,7 @@ namespace eval {
 namespace {
 
 
-	float do_eval(const position& p);
+	float do_eval(const position& p, const pawn_table& pt, const float& lazy_margin, bool& lazy_exit, float* terms = nullptr);
 
 	template<Color c> float eval_pawns(const position& p, einfo& ei);
 	template<Color c> float eval_knights(const position& p, einfo& ei);
@@ -69,15 +73,21 @@ namespace {
 		return 0.0f + 2.22f * log(n + 1); // max of ~20
 	}
 
-	float do_eval(const position& p, const Searchthread& t, const float& lazy_margin) {
+	float do_eval(const position& p, const pawn_table& pt, const float& lazy_margin, bool& lazy_exit, float* terms) {
 
 
 		float score = 0;
 		einfo ei = {};
 		memset(&ei, 0, sizeof(einfo));
 
-		ei.pe = t.pawnTable.fetch(p);
-		ei.me = t.materialTable.fetch(p);
+		// accumulate a (white relative) term, recording it when a breakdown is requested
+		auto add_term = [&](const EvalTerm& term, const float& v) {
+			score += v;
+			if (terms) terms[term] = v;
+		};
+
+		ei.pe = pt.fetch(p);
+		ei.me = material::fetch(p, ei.me_scratch);
 
 		ei.all_pieces = p.all_pieces();
 		ei.empty = ~p.all_pieces();
@@ -94,12 +104,15 @@ namespace {
 		ei.pawn_holes[white] = (ei.pe->backward[white] != 0ULL ? ei.pe->backward[white] << 8 : 0ULL);
 		ei.pawn_holes[black] = (ei.pe->backward[black] != 0ULL ? ei.pe->backward[black] >> 8 : 0ULL);
 
-		score += ei.pe->score;
-		score += ei.me->score;
+		add_term(term_pawn_structure, ei.pe->score);
+		add_term(term_material, ei.me->score);
+		if (terms) terms[term_tempo] = (p.to_move() == white ? p.params.tempo : -p.params.tempo);
 
 		// Return early if eval is above the lazy margin
-		if (lazy_margin > 0 && !ei.me->is_endgame() && abs(score) >= lazy_margin)
+		if (lazy_margin > 0 && !ei.me->is_endgame() && abs(score) >= lazy_margin) {
+			lazy_exit = true;
 			return (p.to_move() == white ? score : -score) + p.params.tempo;
+		}
 
 		// Specialized handling for endgame types
 		if (ei.me->is_endgame()) {
@@ -107,10 +120,25 @@ namespace {
 			auto noPawns = (p.get_pieces<white, pawn>() | p.get_pieces<black, pawn>()) == 0ULL;
 			switch (t) {
 			case KpK:
-				if (noPawns)
+				if (noPawns) {
+					if (terms) std::fill(terms, terms + eval_terms, 0.0f);
 					return Score::draw;
-				score += (eval_kpk<white>(p, ei) - eval_kpk<black>(p, ei));
+				}
+			{
+				float known_win = 0;
+				if (p.number_of(white, pawn) + p.number_of(black, pawn) == 1) {
+					// exact result from the kpk bitbase, a won ending gets a bonus on top of the
+					// regular terms (which still reward pushing the pawn)
+					if (bitbase::probe(p) == 0) {
+						if (terms) std::fill(terms, terms + eval_terms, 0.0f);
+						return Score::draw;
+					}
+					const float known_win_bonus = 600.0f;
+					known_win = (p.get_pieces<white, pawn>() != 0ULL ? known_win_bonus : -known_win_bonus);
+				}
+				add_term(term_endgame, known_win + eval_kpk<white>(p, ei) - eval_kpk<black>(p, ei));
 				break;
+			}
 			case KrrK:
 				// Not necessarily drawn if no pawns...
 				//score += (eval_krrk<white>(p, ei) - eval_krrk<black>(p, ei));
@@ -121,35 +149,39 @@ namespace {
 			case KbbK:
 			case KnK:
 			case KbK:
-				if (noPawns)
+				if (noPawns) {
+					if (terms) std::fill(terms, terms + eval_terms, 0.0f);
 					return Score::draw;
+				}
 				break;
 			}
 		}
 
-		score += (eval_pawns<white>(p, ei) - eval_pawns<black>(p, ei));
+		add_term(term_pawns, eval_pawns<white>(p, ei) - eval_pawns<black>(p, ei));
 		//std::cout << "Score.pawnEval=" << score << std::endl;
-		score += (eval_knights<white>(p, ei) - eval_knights<black>(p, ei));
+		add_term(term_knights, eval_knights<white>(p, ei) - eval_knights<black>(p, ei));
 		//std::cout << "Score.knightEval=" << score << std::endl;
-		score += (eval_bishops<white>(p, ei) - eval_bishops<black>(p, ei));
+		add_term(term_bishops, eval_bishops<white>(p, ei) - eval_bishops<black>(p, ei));
 		//std::cout << "Score.bishopEval=" << score << std::endl;
-		score += (eval_rooks<white>(p, ei) - eval_rooks<black>(p, ei));
+		add_term(term_rooks, eval_rooks<white>(p, ei) - eval_rooks<black>(p, ei));
 		//std::cout << "Score.rookEval=" << score << std::endl;
-		score += (eval_queens<white>(p, ei) - eval_queens<black>(p, ei));
+		add_term(term_queens, eval_queens<white>(p, ei) - eval_queens<black>(p, ei));
 		//std::cout << "Score.queenEval=" << score << std::endl;
-		score += (eval_king<white>(p, ei) - eval_king<black>(p, ei));
+		add_term(term_king, eval_king<white>(p, ei) - eval_king<black>(p, ei));
 		//std::cout << "Score.kingEval=" << score << std::endl;
-		score += (eval_passed_pawns<white>(p, ei) - eval_passed_pawns<black>(p, ei));
+		add_term(term_passed_pawns, eval_passed_pawns<white>(p, ei) - eval_passed_pawns<black>(p, ei));
 		//std::cout << "Score.passedPawnEval=" << score << std::endl;
 
-		if (lazy_margin > 0 && !ei.me->is_endgame() && abs(score) >= lazy_margin)
+		if (lazy_margin > 0 && !ei.me->is_endgame() && abs(score) >= lazy_margin) {
+			lazy_exit = true;
 			return (p.to_move() == white ? score : -score) + p.params.tempo;
+		}
 
 		//score += (eval_weak_squares<white>(p, ei) - eval_weak_squares<black>(p, ei));
 		//std::cout << "Score.weakSquareEval=" << score << std::endl;
-		score += (eval_threats<white>(p, ei) - eval_threats<black>(p, ei));
+		add_term(term_threats, eval_threats<white>(p, ei) - eval_threats<black>(p, ei));
 		//std::cout << "Score.threatEval=" << score << std::endl;
-		score += (eval_space<white>(p, ei) - eval_space<black>(p, ei));
+		add_term(term_space, eval_space<white>(p, ei) - eval_space<black>(p, ei));
 		//std::cout << "Score.spaceEval=" << score << std::endl;
 
 		return (p.to_move() == white ? score : -score) + p.params.tempo;
@@ -238,14 +270,15 @@ namespace {
 
 	template<Color c> float eval_knights(const position& p, einfo& ei) {
 		float score = 0;
-		Square* knights = p.squares_of<c, knight>();
+		U64 knights = p.get_pieces<c, knight>();
 		Color them = Color(c ^ 1);
 		U64 enemies = ei.pieces[them];
 		U64 pawn_targets = (c == white ? p.get_pieces<black, pawn>() : p.get_pieces<white, pawn>());
 		U64 equeen_sq = ei.queen_sqs[them];
 		int ks = p.king_square(c);
 
-		for (Square s = *knights; s != no_square; s = *++knights) {
+		while (knights != 0ULL) {
+			Square s = Square(bits::pop_lsb(knights));
 			score += p.params.sq_score_scaling[knight] * square_score<c>(knight, s);
 
 			// Mobility
@@ -312,7 +345,7 @@ namespace {
 
 	template<Color c> float eval_bishops(const position& p, einfo& ei) {
 		float score = 0;
-		Square* bishops = p.squares_of<c, bishop>();
+		U64 bishops = p.get_pieces<c, bishop>();
 		Color them = Color(c ^ 1);
 		U64 enemies = ei.pieces[them];
 		U64 pawn_targets = (c == white ? p.get_pieces<black, pawn>() : p.get_pieces<white, pawn>());
@@ -329,7 +362,8 @@ namespace {
 			p.get_pieces<white, queen>() | p.get_pieces<white, rook>() | p.get_pieces<white, king>());
 		int ks = p.king_square(c);
 
-		for (Square s = *bishops; s != no_square; s = *++bishops) {
+		while (bishops != 0ULL) {
+			Square s = Square(bits::pop_lsb(bishops));
 			score += p.params.sq_score_scaling[bishop] * square_score<c>(bishop, s);
 
 			if (bitboards::squares[s] & bitboards::colored_sqs[white]) {
@@ -432,7 +466,7 @@ namespace {
 	template<Color c> float eval_rooks(const position& p, einfo& ei) {
 		float score = 0;
 		int rookIdx = 0;
-		Square* rooks = p.squares_of<c, rook>();
+		U64 rooks = p.get_pieces<c, rook>();
 		Color them = Color(c ^ 1);
 		U64 enemies = ei.pieces[them];
 		U64 pawn_targets = (c == white ? p.get_pieces<black, pawn>() : p.get_pieces<white, pawn>());
@@ -441,7 +475,8 @@ namespace {
 			p.get_pieces<black, queen>() | p.get_pieces<black, king>() :
 			p.get_pieces<white, queen>() | p.get_pieces<white, king>());
 
-		for (Square s = *rooks; s != no_square; s = *++rooks) {
+		while (rooks != 0ULL) {
+			Square s = Square(bits::pop_lsb(rooks));
 			score += p.params.sq_score_scaling[rook] * square_score<c>(rook, s);
 
 			rookSquares[rookIdx++] = s;
@@ -535,7 +570,7 @@ namespace {
 
 	template<Color c> float eval_queens(const position& p, einfo& ei) {
 		float score = 0;
-		Square* queens = p.squares_of<c, queen>();
+		U64 queens = p.get_pieces<c, queen>();
 		Color them = Color(c ^ 1);
 		U64 enemies = ei.pieces[them];
 		auto pawn_targets = (c == white ? p.get_pieces<black, pawn>() : p.get_pieces<white, pawn>());
@@ -543,7 +578,8 @@ namespace {
 			p.get_pieces<white, pawn>() | p.get_pieces<white, knight>() | p.get_pieces<white, bishop>() | p.get_pieces<white, rook>() :
 			p.get_pieces<black, pawn>() | p.get_pieces<black, knight>() | p.get_pieces<black, bishop>() | p.get_pieces<black, rook>());
 
-			for (Square s = *queens; s != no_square; s = *++queens) {
+			while (queens != 0ULL) {
+				Square s = Square(bits::pop_lsb(queens));
 				score += p.params.sq_score_scaling[queen] * square_score<c>(queen, s);
 
 			// mobility
@@ -583,11 +619,12 @@ namespace {
 
 	template<Color c> float eval_king(const position& p, einfo& ei) {
 		float score = 0;
-		Square* kings = p.squares_of<c, king>();
+		U64 kings = p.get_pieces<c, king>();
 		Color them = Color(c ^ 1);
 		auto enemyPawns = (c == white ? p.get_pieces<black, pawn>() : p.get_pieces<white, pawn>());
 
-		for (Square s = *kings; s != no_square; s = *++kings) {
+		while (kings != 0ULL) {
+			Square s = Square(bits::pop_lsb(kings));
 
 			if (!ei.me->is_endgame()) {
 				score += p.params.sq_score_scaling[king] * square_score<c>(king, s);
@@ -668,28 +705,30 @@ namespace {
 	}
 
 
-	U64 rowmask = (bitboards::row[Row::r3] | bitboards::row[Row::r4] | bitboards::row[Row::r5] | bitboards::row[Row::r6]);
-	U64 colmask = (bitboards::col[Col::C] | bitboards::col[Col::D] | bitboards::col[Col::E]);
-	U64 spacemask = rowmask | colmask;
-	template<Color c> float eval_space(const position& p, einfo& ei) {
-		float score = 0;
+	// files c-f of each side's own half (ranks 2-4 for white, 7-5 for black)
+	const U64 space_files = (bitboards::col[Col::C] | bitboards::col[Col::D] | bitboards::col[Col::E] | bitboards::col[Col::F]);
+	const U64 space_mask[2] = {
+		space_files & (bitboards::row[Row::r2] | bitboards::row[Row::r3] | bitboards::row[Row::r4]),
+		space_files & (bitboards::row[Row::r7] | bitboards::row[Row::r6] | bitboards::row[Row::r5])
+	};
 
+	// central squares behind our own (not doubled or isolated) pawns that enemy pawns do not attack
+	template<Color c> float eval_space(const position& p, einfo& ei) {
 		if (ei.me->is_endgame())
-			return score;
+			return 0;
 
-		U64 pawns = p.get_pieces<c, pawn>();
-		U64 doubled = ei.pe->doubled[c];
-		U64 isolated = ei.pe->isolated[c];
-		pawns &= ~(doubled | isolated);
-		pawns &= spacemask;
+		const Color them = Color(c ^ 1);
+		const U64 own_pawns = p.get_pieces<c, pawn>();
+		U64 pawns = own_pawns & space_files & ~(ei.pe->doubled[c] | ei.pe->isolated[c]);
 
-		U64 space = 0ULL;
+		U64 behind = 0ULL;
 		while (pawns) {
 			int s = bits::pop_lsb(pawns);
-			space |= util::squares_behind(bitboards::col[util::col(s)], c, s);
+			behind |= util::squares_behind(bitboards::col[util::col(s)], c, s);
 		}
-		score += /*0.25 **/ bits::count(space);
-		return score;
+
+		U64 space = behind & space_mask[c] & ~own_pawns & ~ei.pe->attacks[them];
+		return p.params.space_bonus * bits::count(space);
 	}
 
 
@@ -1193,5 +1232,84 @@ namespace {
 }
 
 namespace eval {
-	float evaluate(const position& p, const Searchthread& t, const float& lazy_margin) { return do_eval(p, t, lazy_margin); }
+	float evaluate(const position& p, const Searchthread& t, const float& lazy_margin, bool* lazy) {
+		float score = 0;
+		const U64 key = p.key();
+		if (lazy) *lazy = false;
+
+		if (t.evalTable.fetch(key, score))
+			return score;
+
+		// only complete evaluations are cached, lazy scores depend on the margin
+		bool lazy_exit = false;
+		score = do_eval(p, t.pawnTable, lazy_margin, lazy_exit);
+		if (!lazy_exit)
+			t.evalTable.save(key, score);
+		if (lazy) *lazy = lazy_exit;
+
+		return score;
+	}
+}
+
+namespace eval {
+	void evaluate(const position& p, const pawn_table& pt, float& score, term_scores* terms) {
+		bool lazy_exit = false;
+		if (terms) terms->fill(0);
+		score = do_eval(p, pt, -1, lazy_exit, (terms ? terms->data() : nullptr));
+	}
+
+
+	template<typename Setup>
+	void evaluate_batch(const size_t& count, Setup&& setup, std::span<float> scores, std::span<term_scores> terms, unsigned num_threads) {
+		assert(scores.size() >= count);
+		assert(terms.empty() || terms.size() >= count);
+
+		num_threads = std::max(1u, std::min(num_threads, unsigned((count + batch_block - 1) / batch_block)));
+		std::atomic<size_t> next(0);
+
+		auto worker = [&]() {
+			pawn_table pt;
+			pt.resize(batch_pawn_table_mb);
+			position scratch;
+			scratch.params = eval::Parameters;
+
+			for (size_t start = next.fetch_add(batch_block); start < count; start = next.fetch_add(batch_block)) {
+				size_t end = std::min(start + batch_block, count);
+				for (size_t i = start; i < end; ++i) {
+					const position& p = setup(i, scratch);
+					evaluate(p, pt, scores[i], (terms.empty() ? nullptr : &terms[i]));
+				}
+			}
+		};
+
+		if (num_threads == 1) {
+			worker();
+			return;
+		}
+
+		Threadpool<Workerthread> pool(num_threads);
+		for (unsigned i = 0; i < num_threads; ++i)
+			pool.enqueue(worker);
+		pool.wait_finished();
+	}
+
+
+	void evaluate_batch(std::span<const position> positions, std::span<float> scores,
+		std::span<term_scores> terms, unsigned num_threads) {
+		evaluate_batch(positions.size(),
+			[&](const size_t& i, position&) -> const position& { return positions[i]; },
+			scores, terms, num_threads);
+	}
+
+
+	void evaluate_batch(std::span<const std::string> fens, std::span<float> scores,
+		std::span<term_scores> terms, unsigned num_threads) {
+		evaluate_batch(fens.size(),
+			[&](const size_t& i, position& scratch) -> const position& {
+				std::istringstream fen(fens[i]);
+				scratch.setup(fen);
+				return scratch;
+			},
+			scores, terms, num_threads);
+	}
 }
@@ -4,6 +4,10 @@
 #ifndef EVALUATE_H
 #define EVALUATE_H
 
+#include <array>
+#include <span>
+#include <string>
+
 #include "types.h"
 #include "utils.h"
 #include "pawns.h"
@@ -19,7 +23,8 @@ struct endgame_info {
 
 struct einfo {
 	pawn_entry* pe;
-	material_entry* me;
+	const material_entry* me;
+	material_entry me_scratch; // material eval for signatures outside the precomputed table
 	endgame_info endgame;
 	U64 pawn_holes[2];
 	U64 all_pieces;
@@ -40,10 +45,45 @@ struct einfo {
 };
 
 
+/// <summary>
+/// Evaluation terms reported by the (optional) per-term breakdown,
+/// every term is given from white's point of view.
+/// </summary>
+enum EvalTerm {
+	term_material, term_pawn_structure, term_endgame, term_pawns, term_knights, term_bishops,
+	term_rooks, term_queens, term_king, term_passed_pawns, term_threats, term_space, term_tempo, eval_terms
+};
+
+typedef std::array<float, eval_terms> term_scores;
+
+
 namespace eval {
 
-	float evaluate(const position& p, const Searchthread& t, const float& lazy_margin);
+	/// <summary>
+	/// Search evaluation through the thread's eval cache, 'lazy' (optional) is set when the score
+	/// is an early exit outside the margin rather than a complete evaluation.
+	/// </summary>
+	float evaluate(const position& p, const Searchthread& t, const float& lazy_margin, bool* lazy = nullptr);
+
+	/// <summary>
+	/// Full (non-lazy) evaluation without the eval cache, only a pawn table is needed.
+	/// The score is relative to the side to move.
+	/// </summary>
+	void evaluate(const position& p, const pawn_table& pt, float& score, term_scores* terms = nullptr);
+
+	const size_t batch_block = 64; // positions handed to a worker at a time
+	const size_t batch_pawn_table_mb = 1;
 
+	/// <summary>
+	/// Batch evaluation for tuning and data generation. Positions are handed out in blocks
+	/// to num_threads workers, each with its own pawn table, and scores[i] (side to move relative)
+	/// and optionally terms[i] are written for position i. Positions given as fen strings
+	/// are set up by the workers.
+	/// </summary>
+	void evaluate_batch(std::span<const position> positions, std::span<float> scores,
+		std::span<term_scores> terms = {}, unsigned num_threads = 1);
+	void evaluate_batch(std::span<const std::string> fens, std::span<float> scores,
+		std::span<term_scores> terms = {}, unsigned num_threads = 1);
 }
 
 namespace eval {
@@ -7,9 +7,12 @@
 #include "options.h"
 #include "info.h"
 #include "bitboards.h"
+#include "bitbase.h"
 #include "uci.h"
 #include "magics.h"
+#include "syzygy.h"
 #include "zobrist.h"
+#include "material.h"
 
 
 std::unique_ptr<options> opts;
@@ -19,9 +22,12 @@ int main(int argc, char* argv[]) {
 	greeting();
 
 	opts = std::unique_ptr<options>(new options(argc, argv));
-	zobrist::load();
-	bitboards::load();
-	magics::load();
+	if (!magics::load(opts->value<std::string>("sliders"))) {
+		std::cout << "..error: failed to build the slider attack tables, exiting" << std::endl;
+		return 1;
+	}
+	bitbase::init();
+	syzygy::init(opts->value<std::string>("syzygypath"));
 	uci::loop();
 
 	return 0;
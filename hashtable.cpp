@@ -1,7 +1,8 @@
 
+#include <algorithm>
+
 #include "hashtable.h"
 #include <xmmintrin.h>
-#include <mmintrin.h>
 
 hash_table ttable;
 
@@ -11,43 +12,67 @@ inline size_t pow2(size_t x) {
 
 
 
-hash_table::hash_table() : sz_mb(0), cluster_count(0) {
-	resize(128);
+hash_table::hash_table() : sz_mb(default_hash_mb), cluster_count(0) {
 }
 
 void hash_table::resize(size_t sizeMb) {
 	sz_mb = sizeMb;
+	entries.reset();
+	cluster_count = 0;
+	init();
+}
+
+void hash_table::init() {
+	if (entries.get() != nullptr)
+		return;
+
 	cluster_count = 1024 * 1024 * sz_mb / sizeof(hash_cluster);
 	cluster_count = pow2(cluster_count);
 	if (cluster_count < 1024) 
 		cluster_count = 1024;
-	if (entries.get() != nullptr)
-		entries.reset();
 
+	// value-initialized, entries are already zeroed
 	entries = std::unique_ptr<hash_cluster[]>(new hash_cluster[cluster_count]());
-	clear();
 }
 
 
 void hash_table::clear() {
-	memset(entries.get(), 0, sizeof(hash_cluster) * cluster_count);
+	if (entries.get() != nullptr)
+		std::fill(entries.get(), entries.get() + cluster_count, hash_cluster{});
+	clear_stats();
 }
 
 
 
-bool hash_table::fetch(const U64& key, hash_data& e) {
-	entry* stored = first_entry(key);
-
-	{ // prefetch.. ?
-		char* addr = (char*)stored;
-		_mm_prefetch(addr, _MM_HINT_T0);
-		_mm_prefetch(addr + 32, _MM_HINT_T0);
-	}
-
+bool hash_table::fetch(const U64& key, hash_data& e, [[maybe_unused]] const U64& verify) {
+	hash_cluster* c = cluster(key);
+	entry* stored = &c->cluster_entries[0];
+	_mm_prefetch((char*)stored, _MM_HINT_T0);
+#ifdef HAVOC_KEY128
+	++probes;
+#endif
 
+	const U16 k = entry::key16(key);
 	for (unsigned i = 0; i < cluster_size; ++i, ++stored) {
-		if ((stored->pkey ^ stored->dkey) == key) {
-			e.decode(stored->dkey);
+		U64 data = stored->data; // single read, the entry may be rewritten concurrently
+		if (data != 0ULL && U16(data) == k) {
+#ifdef HAVOC_KEY128
+			if (c->verify[i] != verify) {
+				++collisions;
+				continue;
+			}
+			++hits;
+#endif
+			e.decode(data);
+
+			// the eval lives outside the entry word, drop it if the entry was rewritten meanwhile
+			e.eval = c->evals[i];
+			if (stored->data != data)
+				e.eval = int16(Score::ninf);
+
+			// still useful in this search, refresh the age so the entry is not replaced as stale
+			else if (e.age != generation)
+				stored->data = (data & ~(0x3FULL << 58)) | (U64(generation) << 58);
 			return true;
 		}
 	}
@@ -58,36 +83,53 @@ bool hash_table::fetch(const U64& key, hash_data& e) {
 void hash_table::save(const U64& key,
 	const U8& depth,
 	const U8& bound,
-	const U8& age,
 	const Move& m,
-	const int16& score, const bool& pv_node) {
-
-	entry* e, * replace;
+	const int16& score, const int16& eval, [[maybe_unused]] const U64& verify) {
 
-	e = replace = first_entry(key);
+	hash_cluster* c = cluster(key);
+	entry* e = &c->cluster_entries[0];
+	entry* replace = e;
+	bool same_key = false;
+	const U16 k = entry::key16(key);
 
 	for (unsigned i = 0; i < cluster_size; ++i, ++e) {
 
-		// empty entry or hash collision
+		// empty entry
 		if (e->empty()) {
 			replace = e;
 			break;
 		}
 
-		// collision handling (depth, age and pv node)
-		else if (((e->pkey) ^ (e->dkey)) == key) {
-			if (age - e->age() > 1) {
-				replace = e;
-				break;
-			}
-			if (e->depth() - depth < 0) {
+		// same position : overwrite unless the stored result is much deeper (exact bounds always overwrite,
+		// results of earlier searches count as shallower)
+#ifdef HAVOC_KEY128
+		if (e->key() == k && c->verify[i] == verify) {
+#else
+		if (e->key() == k) {
+#endif
+			if (bound == bound_exact || int(depth) + age_weight > replace_value(*e)) {
 				replace = e;
+				same_key = true;
 				break;
 			}
+			return;
 		}
 
+		// otherwise evict the least valuable entry : shallow, or written by an earlier search
+		if (replace_value(*e) < replace_value(*replace))
+			replace = e;
 	}
 
-	replace->encode(depth, bound, age, m, score);
-	replace->pkey = key ^ replace->dkey;
+	// a result without a move (e.g. a fail low) keeps the move already stored for the position
+	Move move = m;
+	if (same_key && m.type == Movetype::no_type)
+		move.set(U16(replace->data >> 16));
+
+	entry updated;
+	updated.encode(key, depth, bound, generation, move, score);
+	c->evals[replace - &c->cluster_entries[0]] = eval; // before the entry word, readers matching the new key see it
+	replace->data = updated.data;
+#ifdef HAVOC_KEY128
+	c->verify[replace - &c->cluster_entries[0]] = verify;
+#endif
 }
@@ -10,78 +10,89 @@
 
 const U64 search_bit = (1ULL << 63);
 
+enum Bound { bound_low, bound_high, bound_exact, no_bound };
+
+/// <summary>
+/// 8 byte entry, packed into a single word so it is written and read in one access :
+/// 16 bit key | 16 bit move | 16 bit score | 8 bit depth | 2 bit bound | 6 bit age
+/// The slot index supplies the low key bits, the stored key the upper 16.
+/// </summary>
 struct entry {
-	entry() : pkey(0ULL), dkey(0ULL) { }
+	U64 data = 0ULL;
 
-	U64 pkey;  // zobrist hashing
-	U64 dkey;  // 17 bit val, 8 bit depth, 8 bit bound, 8 bit f, 8 bit t, 8 bit type
+	static inline U16 key16(const U64& key) { return U16(key >> 48); }
 
-	inline bool empty() { return pkey == 0ULL && dkey == 0ULL; }
+	inline bool empty() const { return data == 0ULL; }
+	inline U16 key() const { return U16(data); }
+	inline U8 depth() const { return U8(data >> 48); }
+	inline U8 bound() const { return U8((data >> 56) & 0x3); }
+	inline U8 age() const { return U8(data >> 58); }
 
-	inline void encode(const U8& depth,
+	inline void encode(const U64& key,
+		const U8& depth,
 		const U8& bound,
 		const U8& age,
 		const Move& m,
 		const int16& score) {
-		dkey = 0ULL;
-		dkey |= U64(m.f); // 8 bits;
-		dkey |= (U64(m.t) << 8); // 8 bits
-		dkey |= (U64(m.type) << 16); // 8 bits
-		dkey |= (U64(bound) << 26); // 4 bits;
-		dkey |= (U64(depth + 1) << 30); // 8 bits
-		dkey |= (U64(score < 0 ? -score : score) << 38); // 16 bits
-		dkey |= (U64(score < 0 ? 1ULL : 0ULL) << 54);   // 1 bit
-		dkey |= (U64(age) << 55); // 9 bits .. 
+		data = U64(key16(key)) |
+			(U64(m.data()) << 16) |
+			(U64(U16(score)) << 32) |
+			(U64(depth) << 48) |
+			(U64(bound & 0x3) << 56) |
+			(U64(age & 0x3F) << 58);
 	}
-
-	inline U8 depth() { return U8((dkey & 0xFF0000000) >> 30); }
-	inline U8 bound() { return U8((dkey & 0xF000000) >> 26); }
-	inline U8 age() { return U8((dkey & 0x7F80000000000000 >> 55)); }
 };
 
 
-enum Bound { bound_low, bound_high, bound_exact, no_bound };
-
 struct hash_data {
 	char depth;
 	U8 bound;
 	U8 age;
 	int16 score;
-	U16 pkey;
-	U16 dkey;
-	Move move; // 3 bytes
-
-	inline void decode(const U64& dkey) {
-
-		U8 f = U8(dkey & 0xFF);
-		U8 t = U8((dkey & 0xFF00) >> 8);
-		Movetype type = Movetype((dkey & 0xFF0000) >> 16);
-		bound = U8((dkey & 0xF000000) >> 26);
-		depth = U8((dkey & 0xFF0000000) >> 30);
-		score = int16((dkey & 0xFFFF000000000) >> 38);
-		int sign = int(dkey & (1ULL << 54));
-		score = (sign == 1 ? -score : score);
-		age = U8(dkey & 0x7F80000000000000 >> 55);
-
-		move.set(f, t, type);
+	int16 eval; // static evaluation of the position (Score::ninf : none, e.g. in check)
+	Move move;
+
+	inline void decode(const U64& data) {
+		move.set(U16(data >> 16));
+		score = int16(U16(data >> 32));
+		depth = char(U8(data >> 48));
+		bound = U8((data >> 56) & 0x3);
+		age = U8(data >> 58);
 	}
 };
 
-const unsigned cluster_size = 4;
+const unsigned cluster_size = 6;
+const int age_weight = 8; // depth (half plies) an entry loses per search since it was written
+const size_t default_hash_mb = 128;
 
-struct hash_cluster {
-	// based on entry size = 64 bits / 8 = 8 + 8 bytes
-	// 16 * 4 = 64 bytes, leaving 0 bytes for cache padding
+struct alignas(64) hash_cluster {
+	// 6 entries * 8 bytes + 6 static evals * 2 bytes (+ 4 bytes padding) = one 64 byte cache line
 	entry cluster_entries[cluster_size];
+	int16 evals[cluster_size];
+#ifdef HAVOC_KEY128
+	// verification keys of the entries above (second cache line)
+	U64 verify[cluster_size];
+#endif
 };
+#ifndef HAVOC_KEY128
+static_assert(sizeof(hash_cluster) == 64, "a cluster is one cache line");
+#endif
 
 
+/// <summary>
+/// Clustered transposition table, the table memory is allocated on first use (init)
+/// rather than at static initialization so startup does not pay for zeroing it.
+/// </summary>
 class hash_table {
 private:
 	size_t sz_mb;
 	size_t cluster_count;
 	std::unique_ptr<hash_cluster[]> entries;
-	void alloc(size_t sizeMb);
+	// probe statistics, only counted with HAVOC_KEY128 (the shared counters would cost the search threads)
+	U64 probes = 0;
+	U64 hits = 0;
+	U64 collisions = 0; // 16 bit key matched but the verification key did not
+	U8 generation = 0; // search generation (6 bits), bumped once per search and stored as the entry age
 
 public:
 	hash_table();
@@ -95,17 +106,30 @@ public:
 	void save(const U64& key,
 		const U8& depth,
 		const U8& bound,
-		const U8& age,
 		const Move& m,
-		const int16& score, const bool& pv_node);
-	bool fetch(const U64& key, hash_data& e);
+		const int16& score, const int16& eval, const U64& verify = 0ULL);
+	bool fetch(const U64& key, hash_data& e, const U64& verify = 0ULL);
+	inline hash_cluster* cluster(const U64& key);
 	inline entry* first_entry(const U64& key);
+	void init();
 	void clear();
 	void resize(size_t sizeMb);
+	void clear_stats() { probes = hits = collisions = 0; }
+	void new_search() { generation = U8((generation + 1) & 0x3F); }
+	inline int age_of(const entry& e) const { return (generation - e.age()) & 0x3F; } // searches since the entry was written
+	inline int replace_value(const entry& e) const { return int(e.depth()) - age_weight * age_of(e); }
+
+	U64 probe_count() const { return probes; }
+	U64 hit_count() const { return hits; }
+	U64 collision_count() const { return collisions; }
 };
 
+inline hash_cluster* hash_table::cluster(const U64& key) {
+	return &entries[key & (cluster_count - 1)];
+}
+
 inline entry* hash_table::first_entry(const U64& key) {
-	return &entries[key & (cluster_count - 1)].cluster_entries[0];
+	return &cluster(key)->cluster_entries[0];
 }
 
 extern hash_table ttable; // global transposition table
@@ -1,29 +1,31 @@
 
+#include <iostream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
 #include "magics.h"
 #include "magicsrands.h"
 #include "types.h"
+#include "bitboards.h"
 
 namespace magics {
 	namespace detail {
 
-		struct table {
-			U64 mask;
-			U64 magic;
-			U16 offset;
-			U8 shift;
-
-			inline unsigned entry(const U64& occ_) { return unsigned(magic * (mask & occ_) >> shift); }
-		};
+		// sum over all squares of 2^(number of relevant occupancy bits)
+		const size_t bishop_table_size = 5248;
+		const size_t rook_table_size = 102400;
 
-		std::vector<std::vector<U8>> ridx(64, std::vector<U8>(4096));
-		std::vector<std::vector<U8>> bidx(64, std::vector<U8>(512));
-		std::vector<U64> battks;
-		std::vector<U64> rattks;
-
-		table rtable[64];
-		table btable[64];
+		alignas(64) U64 attack_table[bishop_table_size + rook_table_size];
 
 	} // end namespace detail
+
+	entry rook_entries[64];
+	entry bishop_entries[64];
+	bool use_pext = false;
 }
 
 U64 magics::next_magic(const unsigned int& bits, util::rand<unsigned int>& r) {
@@ -35,14 +37,13 @@ U64 magics::next_magic(const unsigned int& bits, util::rand<unsigned int>& r) {
 
 template<Piece p>
 U64 magics::attacks(const Square& s, const U64& block) {
-	std::vector< std::vector<int> > steps =
-	{ {}, // pawn
-		{}, // knight
+	static const int steps[2][4] =
+	{
 		{-7, 7, -9, 9}, // bishop
 		{-1, 1, -8, 8}  // rook
 	};
 	U64 bm = 0ULL;
-	for (auto& step : steps[p]) {
+	for (const int& step : steps[p == Piece::rook]) {
 		U64 tmp = 0ULL;
 		int sqs = 1;
 
@@ -61,152 +62,93 @@ U64 magics::attacks(const Square& s, const U64& block) {
 	return bm;
 }
 
-bool magics::load() {
-
-	std::vector<U64> occupancy, atks, used;
-	occupancy.reserve(4096); atks.reserve(4096); used.reserve(4096);
-	occupancy.resize(4096); atks.resize(4096); used.resize(4096);
-	util::rand<unsigned int> r;
-
-	// 4096 is computed from counting the number of possible blockers for a rook/bishop at a given square.
-	// E.g. the rook@A1 has 12 squares which can be blocked (A8,H1 have been removed)
-	// in mathematica : sum[12!/(n!*(12-n)!),{n,1,12}] = 4095 .. similar computation for bishop@E4.
-	detail::battks.reserve(1428); detail::battks.resize(1428);
-	detail::rattks.reserve(4900); detail::rattks.resize(4900);
-
-	// structs to provide shorthand indexing
-	struct _attks {
-		std::vector<U64>& operator[](const int& idx) { return (idx == 2 ? detail::battks : detail::rattks); }
-	};
-	struct _idx {
-		std::vector<std::vector<U8>>& operator[](const int& idx) { return (idx == 2 ? detail::bidx : detail::ridx); }
-	};
-	_attks attack_arr;
-	_idx indices;
-
-	// these offsets tally the number of unique attack arrays
-	// that exist for bishop/rook at the given square. E.g. all values
-	// for the rook can be computed by 
-	// value = empty_row1_sqs * empty_row2_sqs * empty_col1_sqs * empty_col2_sqs
-	// rook@A1 has 49 unique attack patterns (but 4096 occupancies at A1)
-	std::vector<std::vector<int>> offsets =
-	{
-		{}, // pawn
-		{}, // knight
-		{
-7, 6, 10, 12, 12, 10, 6, 7,
-6, 6, 10, 12, 12, 10, 6, 6,
-10, 10, 40, 48, 48, 40, 10, 10,
-12, 12, 48, 108, 108, 48, 12, 12,
-12, 12, 48, 108, 108, 48, 12, 12,
-10, 10, 40, 48, 48, 40, 10, 10,
-6, 6, 10, 12, 12, 10, 6, 6,
-7, 6, 10, 12, 12, 10, 6, 7
-		},
-		{
-49, 42, 70, 84, 84, 70, 42, 49,
-42, 36, 60, 72, 72, 60, 36, 42,
-70, 60, 100, 120, 120, 100, 60, 70,
-84, 72, 120, 144, 144, 120, 72, 84,
-84, 72, 120, 144, 144, 120, 72, 84,
-70, 60, 100, 120, 120, 100, 60, 70,
-42, 36, 60, 72, 72, 60, 36, 42,
-49, 42, 70, 84, 84, 70, 42, 49
-		}
-	};
-
-	for (Piece p = Piece::bishop; p <= Piece::rook; ++p) {
-
-		size_t bits = 6;
-
-		for (Square s = Square::A1; s <= Square::H8; ++s) {
-
-			U64 mask = (p == Piece::rook ? bitboards::rmask[s] : bitboards::bmask[s]);
-			U8 shift = 64 - bits::count(mask);
-			U64 b = 0ULL;
-			int occ_size = 0;
-			U64 magic = 0ULL;
-			U64 filter = 0ULL;
-
-			// enumerate all occupancy combinations of the bishop/rook mask
-			do {
-				occupancy[occ_size] = b;
-				atks[occ_size++] = (p == Piece::bishop ? attacks<Piece::bishop>(s, b) :
-					attacks<Piece::rook>(s, b));
-				b = (b - mask) & mask;
-			} while (b);
+namespace {
+
+	void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(_MSC_VER)
+		int r[4];
+		__cpuidex(r, int(leaf), int(subleaf));
+		for (int i = 0; i < 4; ++i) regs[i] = unsigned(r[i]);
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
 
-			int count = 0;
-			//do {
+	bool cpu_has_bmi2() {
+		unsigned regs[4];
+		cpuid(0, 0, regs);
+		if (regs[0] < 7)
+			return false;
+		cpuid(7, 0, regs);
+		return (regs[1] & (1u << 8)) != 0;
+	}
+}
 
-			//  do {
-			//    magic = next_magic(bits, r);
-			//    filter = (magic * mask) & 0xFFFF000000000000;
-			//  } while (bits::count(filter) < 7);
 
-			//  used.assign(occ_size, 0);
+/// <summary>
+/// PEXT is only preferred where it is fast : AMD before Zen 3 (family 0x19) implements it in microcode.
+/// </summary>
+bool magics::cpu_has_fast_pext() {
+	if (!cpu_has_bmi2())
+		return false;
+
+	unsigned regs[4];
+	cpuid(0, 0, regs);
+	bool amd = (regs[1] == 0x68747541); // "Auth" (enticAMD)
+	cpuid(1, 0, regs);
+	unsigned family = (regs[0] >> 8) & 0xF;
+	if (family == 0xF)
+		family += (regs[0] >> 20) & 0xFF;
+	return !amd || family >= 0x19;
+}
 
-			//  for (count = 0; count < occ_size; ++count) {
-			//    unsigned int idx = unsigned(magic * (mask & occupancy[count]) >> shift);
 
-			//    if ((used[idx] == 0ULL &&
-			//      (used[idx] != occupancy[count] ||
-			//        occupancy[count] == 0ULL))) used[idx] = occupancy[count];
-			//    else break;
-			//  }
-			//} while (count != occ_size);
+bool magics::load(const std::string& backend) {
 
-			// remove redundant occupancies 
-			U16 offset = 0;
-			magic = (p == bishop ? bishop_magics[s] : rook_magics[s]);
+	use_pext = (backend == "pext" ? cpu_has_bmi2() : backend != "fancy" && cpu_has_fast_pext());
+	if (backend == "pext" && !use_pext)
+		std::cout << "..pext slider attacks are not supported on this cpu, using fancy magics" << std::endl;
 
-			for (int i = 0; i < s; ++i) offset += offsets[p][i];
+	std::fill(std::begin(detail::attack_table), std::end(detail::attack_table), 0ULL);
+	size_t offset = 0;
 
-			U64 stored[64][144] = { {} };
+	for (Piece p = Piece::bishop; p <= Piece::rook; ++p) {
+		for (Square s = Square::A1; s <= Square::H8; ++s) {
 
-			// filter those occupancies which are redundant, the index : r_occ[s][idx] + offset
-			for (int i = 0; i < occ_size; ++i) {
-				unsigned int idx = unsigned(magic * (mask & occupancy[i]) >> shift);
-				U64 atk = atks[i];
+			entry& e = (p == Piece::rook ? rook_entries[s] : bishop_entries[s]);
+			e.mask = (p == Piece::rook ? bitboards::rmask[s] : bitboards::bmask[s]);
+			e.magic = (p == Piece::rook ? rook_magics[s] : bishop_magics[s]);
+			e.shift = 64 - bits::count(e.mask);
+			e.attacks = detail::attack_table + offset;
 
-				int k = 0;
-				while (k < 144) {
-					U64 prev = stored[s][k];
-					if (!prev && prev != atk) {
-						stored[s][k] = atk;
-						break;
-					}
-					else if (prev == atk) break;
-					++k;
+			// enumerate all occupancy combinations of the bishop/rook mask (carry-rippler),
+			// occupancies may only share a slot when their attack sets are identical
+			U64* table = detail::attack_table + offset;
+			U64 b = 0ULL;
+			do {
+				U64 atks = (p == Piece::bishop ? attacks<Piece::bishop>(s, b) : attacks<Piece::rook>(s, b));
+				unsigned idx = index(e, b);
+				if (table[idx] != 0ULL && table[idx] != atks) {
+					std::cout << "..error: bad magic for square " << s << std::endl;
+					return false;
 				}
-				indices[p][s][idx] = k;
-
-				int o = indices[p][s][idx] + offset; // total offset
-				attack_arr[p][o] = atks[i];
-				detail::table* tab = (p == Piece::bishop ? detail::btable : detail::rtable);
-				tab[s].magic = magic;
-				tab[s].mask = mask;
-				tab[s].shift = shift;
-				tab[s].offset = offset;
+				table[idx] = atks;
+				b = (b - e.mask) & e.mask;
+			} while (b);
 
-			}
-			//std::cout << "s " << s <<  "occ size: " << occ_size << std::endl;
-			//std::string eol = (s % 6 != 0 ? "), " : "),\n");
-			//std::cout << "U64(" << magic << eol;
-			//if (s == 63) std::cout << "==============================" << std::endl;
+			offset += (size_t(1) << bits::count(e.mask));
 		}
 	}
-	return true;
+	return offset == detail::bishop_table_size + detail::rook_table_size;
 }
 
-namespace magics {
-	template<> U64 attacks<Piece::rook>(const U64& occ, const Square& s) {
-		using namespace detail;
-		return rattks[ridx[s][rtable[s].entry(occ)] + rtable[s].offset];
-	}
 
-	template<> U64 attacks<Piece::bishop>(const U64& occ, const Square& s) {
-		using namespace detail;
-		return battks[bidx[s][btable[s].entry(occ)] + btable[s].offset];
-	}
+magics::Backend magics::backend() {
+	return (use_pext ? Backend::pext : Backend::fancy);
+}
+
+
+std::string magics::backend_name() {
+	return (use_pext ? "pext" : "fancy magics");
 }
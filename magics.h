@@ -6,6 +6,11 @@
 #include <memory>
 #include <algorithm>
 #include <random>
+#include <string>
+
+#ifdef _MSC_VER
+#include <immintrin.h>
+#endif
 
 #include "types.h"
 #include "bits.h"
@@ -13,14 +18,69 @@
 
 namespace magics {
 
+	enum Backend { fancy, pext };
+
+	/// <summary>
+	/// Per-square slider lookup, the attack sets of all squares live in a single flat table.
+	/// fancy : attacks[((occ & mask) * magic) >> shift]
+	/// pext  : attacks[pext(occ, mask)]
+	/// </summary>
+	struct alignas(32) entry {
+		U64 mask;
+		U64 magic;
+		const U64* attacks;
+		unsigned shift;
+	};
+
+	extern entry rook_entries[64];
+	extern entry bishop_entries[64];
+	extern bool use_pext;
+
 	template<Piece p>
 	U64 attacks(const Square& s, const U64& block);
 
 	template<Piece p>
-	U64 attacks(const U64& occ, const Square& s);
+	inline U64 attacks(const U64& occ, const Square& s);
 
 	U64 next_magic(const unsigned int& bits, util::rand<unsigned int>& r);
-	bool load();
+	bool cpu_has_fast_pext();
+	bool load(const std::string& backend = "");
+	Backend backend();
+	std::string backend_name();
+
+	inline U64 pext_u64(const U64& b, const U64& m) {
+#if defined(_MSC_VER) && defined(_64BIT)
+		return _pext_u64(b, m);
+#elif defined(__GNUC__) && defined(__x86_64__)
+		// inline asm so the instruction is available without compiling everything for bmi2,
+		// it is only ever executed after the runtime cpu check
+		U64 r;
+		__asm__("pextq %2, %1, %0" : "=r"(r) : "r"(b), "rm"(m));
+		return r;
+#else
+		U64 r = 0ULL;
+		U64 mask = m;
+		for (U64 bb = 1ULL; mask; bb += bb) {
+			if (b & mask & (0ULL - mask)) r |= bb;
+			mask &= mask - 1;
+		}
+		return r;
+#endif
+	}
+
+	inline unsigned index(const entry& e, const U64& occ) {
+		return unsigned(use_pext ? pext_u64(occ, e.mask) : ((occ & e.mask) * e.magic) >> e.shift);
+	}
+
+	template<> inline U64 attacks<Piece::rook>(const U64& occ, const Square& s) {
+		const entry& e = rook_entries[s];
+		return e.attacks[index(e, occ)];
+	}
+
+	template<> inline U64 attacks<Piece::bishop>(const U64& occ, const Square& s) {
+		const entry& e = bishop_entries[s];
+		return e.attacks[index(e, occ)];
+	}
 }
 
 #endif
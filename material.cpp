@@ -1,5 +1,4 @@
-
-#include <vector>
+#include <algorithm>
 
 #include "material.h"
 #include "types.h"
@@ -8,72 +7,12 @@
 #include "position.h"
 
 
-//material_table mtable;
-
-
-int16 evaluate(const position& p, material_entry& e);
-
-
-inline size_t pow2(size_t x) {
-	return x <= 2 ? x : pow2(x >> 1) >> 1;
-}
-
-
-material_table::material_table() : sz_mb(0), count(0) {
-	init();
-}
-
-material_table::material_table(const material_table& o) {
-	entries = std::shared_ptr<material_entry[]>(new material_entry[count]());
-	std::memcpy(entries.get(), o.entries.get(), count * sizeof(material_entry));
-	entries = o.entries;
-	sz_mb = o.sz_mb;
-	count = o.count;
-}
-
-
-material_table& material_table::operator=(const material_table& o) {
-	entries = std::shared_ptr<material_entry[]>(new material_entry[count]());
-	std::memcpy(entries.get(), o.entries.get(), count * sizeof(material_entry));
-	sz_mb = o.sz_mb;
-	count = o.count;
-	return *this;
-}
-
-
-void material_table::init() {
-	sz_mb = 50 * 1024;
-	count = 1024 * sz_mb / sizeof(material_entry);
-	if (count < 1024) count = 1024;
-	entries = std::shared_ptr<material_entry[]>(new material_entry[count]());
-}
-
-void material_table::clear() {
-	memset(entries.get(), 0, count * sizeof(material_entry));
-}
-
-
-material_entry* material_table::fetch(const position& p) const {
-	U64 k = p.material_key();
-	unsigned idx = k & (count - 1);
-	if (entries[idx].key == k) {
-		return &entries[idx];
-	}
-	else {
-		entries[idx] = {};
-		entries[idx].key = k;
-		entries[idx].score = evaluate(p, entries[idx]);
-		return &entries[idx];
-	}
-}
-
+namespace {
 
+	typedef std::array<int, pieces> side_counts;
 
-int16 evaluate(const position& p, material_entry& e) {
-
-	std::vector<int> sign{ 1, -1 };
-	std::vector<float> material_vals{ 0.0f, 300.0f, 315.0f, 480.0f, 910.0f };
-	const std::vector<Piece> pieces{ knight, bishop, rook, queen }; // pawns handled in pawns.cpp
+	constexpr float material_vals[] = { 0.0f, 300.0f, 315.0f, 480.0f, 910.0f };
+	constexpr Piece eval_pieces[] = { knight, bishop, rook, queen }; // pawns handled in pawns.cpp
 
 	// pawn count adjustments for the rook and knight
 	// 1. the knight becomes less valuable as pawns dissapear
@@ -91,53 +30,64 @@ int16 evaluate(const position& p, material_entry& e) {
 	//	//material_vals[queen] += minor_pawn_adjust;
 	//}
 
-	int16 score = 0;
-	e.endgame = EndgameType::none;
-	auto eg_pieces = std::vector< std::vector<int> >{
-		{ 0, 0, 0, 0, 0 }, // p, n, b, r, q
-		{ 0, 0, 0, 0, 0 } // p, n, b, r, q
-	};
-	auto total = std::vector<int>{ 0, 0 };
+	constexpr int16 side_material(const side_counts& number) {
+		int16 score = 0;
+		for (const auto& piece : eval_pieces)
+			score += number[piece] * material_vals[piece];
+		return score;
+	}
 
-	for (Color c = white; c <= black; ++c) {
-		for (const auto& piece : pieces) {
-			int n = p.number_of(c, piece);
-			e.number[piece] += n;
-			score += sign[c] * n * material_vals[piece];
-			total[c] += n;
-			eg_pieces[c][piece] += n;
-		}
+	constexpr int side_total(const side_counts& number) {
+		int total = 0;
+		for (const auto& piece : eval_pieces)
+			total += number[piece];
+		return total;
+	}
+
+	constexpr int side_phase(const side_counts& number) {
+		return number[knight] + number[bishop] + 2 * number[rook] + 4 * number[queen];
 	}
-	auto total_eg = (total[white] + total[black]);
-	// encoding endgame type if applicable
-	// see types.h for enumeration of different endgame types
-	if (total_eg == 0)
-		e.endgame = EndgameType::KpK;
 
-	else if (total_eg == 2 && eg_pieces[white][rook] == 1 && eg_pieces[black][rook] == 1)
-		e.endgame = EndgameType::KrrK;
+	constexpr U8 game_phase(const side_counts& w, const side_counts& b) {
+		return U8(std::min(side_phase(w) + side_phase(b), material::max_phase));
+	}
+
+	/// <summary>
+	/// Encoding endgame type if applicable (at most 2 pieces left on the board),
+	/// see types.h for enumeration of different endgame types
+	/// </summary>
+	constexpr EndgameType endgame_type(const side_counts& w, const side_counts& b) {
+		auto total_eg = side_total(w) + side_total(b);
+
+		if (total_eg == 0)
+			return EndgameType::KpK;
+
+		else if (total_eg == 2 && w[rook] == 1 && b[rook] == 1)
+			return EndgameType::KrrK;
 
-	else if (total_eg == 2 && eg_pieces[white][bishop] == 1 && eg_pieces[black][knight] == 1)
-		e.endgame = EndgameType::KbnK;
+		else if (total_eg == 2 && w[bishop] == 1 && b[knight] == 1)
+			return EndgameType::KbnK;
 
-	else if (total_eg == 2 && eg_pieces[white][knight] == 1 && eg_pieces[black][bishop] == 1)
-		e.endgame = EndgameType::KnbK;
+		else if (total_eg == 2 && w[knight] == 1 && b[bishop] == 1)
+			return EndgameType::KnbK;
 
-	else if (total_eg == 2 && eg_pieces[white][bishop] == 1 && eg_pieces[black][bishop] == 1)
-		e.endgame = EndgameType::KbbK;
+		else if (total_eg == 2 && w[bishop] == 1 && b[bishop] == 1)
+			return EndgameType::KbbK;
 
-	else if (total_eg == 2 && eg_pieces[white][knight] == 1 && eg_pieces[black][knight] == 1)
-		e.endgame = EndgameType::KnnK;
+		else if (total_eg == 2 && w[knight] == 1 && b[knight] == 1)
+			return EndgameType::KnnK;
 
-	else if (total_eg == 1 && (eg_pieces[white][bishop] == 1 || eg_pieces[black][bishop] == 1))
-		e.endgame = EndgameType::KbK;
+		else if (total_eg == 1 && (w[bishop] == 1 || b[bishop] == 1))
+			return EndgameType::KbK;
 
-	else if (total_eg == 1 && (eg_pieces[white][knight] == 1 || eg_pieces[black][knight] == 1))
-		e.endgame = EndgameType::KnK;
+		else if (total_eg == 1 && (w[knight] == 1 || b[knight] == 1))
+			return EndgameType::KnK;
 
-	else if (total_eg <= 2)
-		e.endgame = EndgameType::Unknown;
+		else if (total_eg <= 2)
+			return EndgameType::Unknown;
 
+		return EndgameType::none;
+	}
 
 	// endgame linear interpolation coefficient
 	// computed from piece count - excludes pawns
@@ -146,5 +96,65 @@ int16 evaluate(const position& p, material_entry& e) {
 	// coeff = -1/12*total + 7/6
 	//e.endgame_coeff = std::min(-0.083333f * total + 1.16667f, 1.0f);
 
-	return score;
+	constexpr side_counts signature_counts(unsigned csig) {
+		side_counts number{};
+		for (const auto& piece : eval_pieces) {
+			unsigned radix = (piece == queen ? material::queen_radix : material::minor_radix);
+			number[piece] = csig % radix;
+			csig /= radix;
+		}
+		return number;
+	}
+}
+
+
+namespace material {
+
+	// score and endgame type are built from the per-color signatures (192 each)
+	// to keep the compile-time evaluation cheap
+	constexpr std::array<material_entry, signatures> table = [] {
+		std::array<side_counts, color_signatures> counts{};
+		std::array<int16, color_signatures> scores{};
+		std::array<int, color_signatures> totals{};
+		for (unsigned csig = 0; csig < color_signatures; ++csig) {
+			counts[csig] = signature_counts(csig);
+			scores[csig] = side_material(counts[csig]);
+			totals[csig] = side_total(counts[csig]);
+		}
+
+		std::array<material_entry, signatures> t{};
+		for (unsigned b = 0; b < color_signatures; ++b) {
+			for (unsigned w = 0; w < color_signatures; ++w) {
+				material_entry& e = t[w + b * color_signatures];
+				e.score = scores[w] - scores[b];
+				e.phase = game_phase(counts[w], counts[b]);
+				if (totals[w] + totals[b] <= 2)
+					e.endgame = endgame_type(counts[w], counts[b]);
+			}
+		}
+		return t;
+	}();
+}
+
+
+const material_entry* material::fetch(const position& p, material_entry& scratch) {
+	if (p.material_overflow() == 0)
+		return &table[p.material_index()];
+
+	std::array<std::array<int, pieces>, 2> number;
+	for (Color c = white; c <= black; ++c) {
+		for (Piece piece = pawn; piece <= king; ++piece)
+			number[c][piece] = p.number_of(c, piece);
+	}
+	scratch = {};
+	evaluate(number, scratch);
+	return &scratch;
+}
+
+
+
+void material::evaluate(const std::array<std::array<int, pieces>, 2>& number, material_entry& e) {
+	e.score = side_material(number[white]) - side_material(number[black]);
+	e.endgame = endgame_type(number[white], number[black]);
+	e.phase = game_phase(number[white], number[black]);
 }
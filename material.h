@@ -1,46 +1,50 @@
-
 #pragma once
 
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
-#include <memory>
+#include <array>
 
 #include "types.h"
 
 class position;
 
 struct material_entry {
-	U64 key;
-	int16 score;
-	double endgame_coeff; // interpolation between middle and endgame
+	int16 score = 0;
 	EndgameType endgame = EndgameType::none;
-	U8 number[5]; // knight, bishop, rook, queen
-	inline bool is_endgame() { return endgame != EndgameType::none; }
+	U8 phase = 0; // non-pawn material, minors 1, rooks 2, queens 4 : 24 at the start, 0 with bare kings/pawns
+	inline bool is_endgame() const { return endgame != EndgameType::none; }
 };
 
 
-class material_table {
-private:
-	size_t sz_mb;
-	size_t count;
-	std::shared_ptr<material_entry[]> entries;
-
-	void init();
+/// <summary>
+/// Material signatures are enumerated up front: every combination of
+/// knights, bishops, rooks (0-3) and queens (0-2) per color maps to a unique slot
+/// in a table generated at compile time. The signature index is kept incrementally in piece_data,
+/// positions outside the enumerated range (multiple under-promotions etc.) are evaluated on the fly.
+/// </summary>
+namespace material {
 
-public:
-	material_table();
-	material_table(const material_table& o);
-	material_table& operator=(const material_table& o);
+	const unsigned minor_radix = 4; // knights, bishops, rooks : 0-3
+	const unsigned queen_radix = 3; // queens : 0-2
+	const unsigned color_signatures = minor_radix * minor_radix * minor_radix * queen_radix;
+	const unsigned signatures = color_signatures * color_signatures;
+	const int max_phase = 24; // phase of the starting material (promotions are capped to it)
 
-	~material_table() {}
+	// index increment for a single piece of each type/color
+	constexpr U32 piece_weight[2][pieces] = {
+		{ 0, 1, minor_radix, minor_radix * minor_radix, minor_radix * minor_radix * minor_radix, 0 },
+		{ 0, color_signatures, color_signatures * minor_radix,
+			color_signatures * minor_radix * minor_radix, color_signatures * minor_radix * minor_radix * minor_radix, 0 }
+	};
 
-	void clear();
-	material_entry* fetch(const position& p) const;
-
-};
+	// max count of each piece type representable by the signature index
+	constexpr int max_count[pieces] = { 8, minor_radix - 1, minor_radix - 1, minor_radix - 1, queen_radix - 1, 1 };
 
+	extern const std::array<material_entry, signatures> table;
 
-//extern material_table mtable;
+	void evaluate(const std::array<std::array<int, pieces>, 2>& number, material_entry& e);
+	const material_entry* fetch(const position& p, material_entry& scratch);
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -19,16 +19,14 @@ enum Dir { N, S, NN, SS, NW, NE, SW, SE, no_dir };
 
 class Movegen {
 	int last;
-	Move list[218]; // max moves in any chess position
+	union { Move list[218]; }; // max moves in any chess position, left uninitialized (only [0, last) is read)
 	Color us, them;
 	U64 rank2, rank7;
 	U64 empty, pawns, pawns2, pawns7;
 	std::vector<U64> bishop_mvs, rook_mvs, queen_mvs;
-	Square* knights;
-	Square* bishops;
-	Square* rooks;
-	Square* queens;
-	Square* kings;
+	U64 knights, bishops, rooks, queens;
+	Square ksq, eks;
+	U64 dc_candidates; // our pieces blocking one of our sliders from the enemy king
 	U64 enemies, all_pieces, qtarget, ctarget, check_target, evasion_target;
 	Square eps;
 	bool can_castle_ks, can_castle_qs;
@@ -49,6 +47,9 @@ class Movegen {
 	inline void quiet_promotions(U64& quiets);
 	inline void encode_capture_promotions(U64& b, const int& f);
 
+	template<Piece p>
+	inline void slider_checks(U64 pcs, const U64& check_sqs);
+
 public:
 	Movegen() : last(0) {}
 	Movegen(const position& pos) : last(0) { initialize(pos); }
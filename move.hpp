@@ -22,14 +22,14 @@ namespace {
 
 template<Movetype mt>
 inline void Movegen::encode(U64& b, const int& f) {
-	while (b) list[last++].set(f, bits::pop_lsb(b), mt);
+	while (b) list[last++] = Move(f, bits::pop_lsb(b), mt);
 }
 
 template<Movetype mt>
 inline void Movegen::encode_pawn_pushes(U64& b, const int& dir) {
 	while (b) {
 		int to = bits::pop_lsb(b);
-		list[last++].set(to + dir, to, mt);
+		list[last++] = Move(to + dir, to, mt);
 	}
 }
 
@@ -37,10 +37,10 @@ inline void Movegen::encode_promotions(U64& b, const int& dir) {
 	while (b) {
 		Square to = Square(bits::pop_lsb(b));
 		Square f = Square(to + dir);
-		list[last++].set(f, to, promotion_q);
-		list[last++].set(f, to, promotion_r);
-		list[last++].set(f, to, promotion_b);
-		list[last++].set(f, to, promotion_n);
+		list[last++] = Move(f, to, promotion_q);
+		list[last++] = Move(f, to, promotion_r);
+		list[last++] = Move(f, to, promotion_b);
+		list[last++] = Move(f, to, promotion_n);
 	}
 }
 
@@ -48,10 +48,10 @@ inline void Movegen::encode_capture_promotions(U64& b, const int& dir) {
 	while (b) {
 		Square to = Square(bits::pop_lsb(b));
 		Square f = Square(to + dir);
-		list[last++].set(f, to, capture_promotion_q);
-		list[last++].set(f, to, capture_promotion_r);
-		list[last++].set(f, to, capture_promotion_b);
-		list[last++].set(f, to, capture_promotion_n);
+		list[last++] = Move(f, to, capture_promotion_q);
+		list[last++] = Move(f, to, capture_promotion_r);
+		list[last++] = Move(f, to, capture_promotion_b);
+		list[last++] = Move(f, to, capture_promotion_n);
 	}
 }
 
@@ -81,6 +81,10 @@ inline void Movegen::initialize(const position& p) {
 	all_pieces = p.all_pieces();
 	empty = ~all_pieces;
 
+	ksq = p.king_square();
+	eks = p.king_square(them);
+	dc_candidates = p.discovered_check_candidates();
+
 	can_castle_ks = p.can_castle_ks();
 	can_castle_qs = p.can_castle_qs();
 
@@ -100,22 +104,20 @@ inline void Movegen::initialize(const position& p) {
 		rank2 = bitboards::row[r2];
 		rank7 = bitboards::row[r7];
 		pawns = p.get_pieces<white, pawn>();
-		knights = p.squares_of<white, knight>();
-		bishops = p.squares_of<white, bishop>();
-		rooks = p.squares_of<white, rook>();
-		queens = p.squares_of<white, queen>();
-		kings = p.squares_of<white, king>();
+		knights = p.get_pieces<white, knight>();
+		bishops = p.get_pieces<white, bishop>();
+		rooks = p.get_pieces<white, rook>();
+		queens = p.get_pieces<white, queen>();
 		enemies = p.get_pieces<black>();
 	}
 	else {
 		rank2 = bitboards::row[r7];
 		rank7 = bitboards::row[r2];
 		pawns = p.get_pieces<black, pawn>();
-		knights = p.squares_of<black, knight>();
-		bishops = p.squares_of<black, bishop>();
-		rooks = p.squares_of<black, rook>();
-		queens = p.squares_of<black, queen>();
-		kings = p.squares_of<black, king>();
+		knights = p.get_pieces<black, knight>();
+		bishops = p.get_pieces<black, bishop>();
+		rooks = p.get_pieces<black, rook>();
+		queens = p.get_pieces<black, queen>();
 		enemies = p.get_pieces<white>();
 	}
 
@@ -279,28 +281,31 @@ inline void Movegen::generate<capture_promotion, pawn>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, knight>() {
-	for (Square* s = &knights[0]; *s != no_square; ++s) {
-		U64 mvs = bitboards::nmask[*s] & qtarget;
-		if (mvs != 0ULL) encode<quiet>(mvs, *s);
+	for (U64 b = knights; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = bitboards::nmask[s] & qtarget;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<capture, knight>() {
-	for (Square* s = &knights[0]; *s != no_square; ++s) {
-		U64 mvs = bitboards::nmask[*s] & ctarget;
-		if (mvs != 0ULL) encode<capture>(mvs, *s);
+	for (U64 b = knights; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = bitboards::nmask[s] & ctarget;
+		if (mvs != 0ULL) encode<capture>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, knight>() {
-	for (Square* s = &knights[0]; *s != no_square; ++s) {
-		U64 qmvs = bitboards::nmask[*s] & qtarget;
-		if (qmvs != 0ULL) encode<quiet>(qmvs, *s);
+	for (U64 b = knights; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 qmvs = bitboards::nmask[s] & qtarget;
+		if (qmvs != 0ULL) encode<quiet>(qmvs, s);
 
-		U64 cmvs = bitboards::nmask[*s] & ctarget;
-		if (cmvs != 0ULL) encode<capture>(cmvs, *s);
+		U64 cmvs = bitboards::nmask[s] & ctarget;
+		if (cmvs != 0ULL) encode<capture>(cmvs, s);
 	}
 }
 
@@ -309,30 +314,33 @@ inline void Movegen::generate<pseudo_legal, knight>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, bishop>() {
-	for (Square* s = &bishops[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<bishop>(all_pieces, *s) & qtarget;
-		if (mvs != 0ULL) encode<quiet>(mvs, *s);
+	for (U64 b = bishops; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<bishop>(all_pieces, s) & qtarget;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<capture, bishop>() {
-	for (Square* s = &bishops[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<bishop>(all_pieces, *s) & ctarget;
-		if (mvs != 0ULL) encode<capture>(mvs, *s);
+	for (U64 b = bishops; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<bishop>(all_pieces, s) & ctarget;
+		if (mvs != 0ULL) encode<capture>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, bishop>() {
-	for (Square* s = &bishops[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<bishop>(all_pieces, *s);
+	for (U64 b = bishops; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<bishop>(all_pieces, s);
 
 		U64 q = mvs & qtarget;
-		if (q != 0ULL) encode<quiet>(q, *s);
+		if (q != 0ULL) encode<quiet>(q, s);
 
 		U64 c = mvs & ctarget;
-		if (c != 0ULL) encode<capture>(c, *s);
+		if (c != 0ULL) encode<capture>(c, s);
 	}
 }
 
@@ -341,30 +349,33 @@ inline void Movegen::generate<pseudo_legal, bishop>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, rook>() {
-	for (Square* s = &rooks[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<rook>(all_pieces, *s) & qtarget;
-		if (mvs != 0ULL) encode<quiet>(mvs, *s);
+	for (U64 b = rooks; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<rook>(all_pieces, s) & qtarget;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<capture, rook>() {
-	for (Square* s = &rooks[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<rook>(all_pieces, *s) & ctarget;
-		if (mvs != 0ULL) encode<capture>(mvs, *s);
+	for (U64 b = rooks; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<rook>(all_pieces, s) & ctarget;
+		if (mvs != 0ULL) encode<capture>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, rook>() {
-	for (Square* s = &rooks[0]; *s != no_square; ++s) {
-		U64 mvs = magics::attacks<rook>(all_pieces, *s);
+	for (U64 b = rooks; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = magics::attacks<rook>(all_pieces, s);
 
 		U64 q = mvs & qtarget;
-		if (q != 0ULL) encode<quiet>(q, *s);
+		if (q != 0ULL) encode<quiet>(q, s);
 
 		U64 c = mvs & ctarget;
-		if (c != 0ULL) encode<capture>(c, *s);
+		if (c != 0ULL) encode<capture>(c, s);
 	}
 }
 
@@ -373,35 +384,38 @@ inline void Movegen::generate<pseudo_legal, rook>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, queen>() {
-	for (Square* s = &queens[0]; *s != no_square; ++s) {
-		U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-			magics::attacks<rook>(all_pieces, *s)) & qtarget;
-		if (mvs != 0ULL) encode<quiet>(mvs, *s);
+	for (U64 b = queens; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+			magics::attacks<rook>(all_pieces, s)) & qtarget;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<capture, queen>() {
 
-	for (Square* s = &queens[0]; *s != no_square; ++s) {
-		U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-			magics::attacks<rook>(all_pieces, *s)) & ctarget;
-		if (mvs != 0ULL) encode<capture>(mvs, *s);
+	for (U64 b = queens; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+			magics::attacks<rook>(all_pieces, s)) & ctarget;
+		if (mvs != 0ULL) encode<capture>(mvs, s);
 	}
 }
 
 template<>
 inline void Movegen::generate<pseudo_legal, queen>() {
 
-	for (Square* s = &queens[0]; *s != no_square; ++s) {
-		U64 mvs = (magics::attacks<bishop>(all_pieces, *s) |
-			magics::attacks<rook>(all_pieces, *s));
+	for (U64 b = queens; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = (magics::attacks<bishop>(all_pieces, s) |
+			magics::attacks<rook>(all_pieces, s));
 
 		U64 q = mvs & qtarget;
-		if (q != 0ULL) encode<quiet>(q, *s);
+		if (q != 0ULL) encode<quiet>(q, s);
 
 		U64 c = mvs & ctarget;
-		if (c != 0ULL) encode<capture>(c, *s);
+		if (c != 0ULL) encode<capture>(c, s);
 	}
 }
 
@@ -410,22 +424,22 @@ inline void Movegen::generate<pseudo_legal, queen>() {
 //------------------------------
 template<>
 inline void Movegen::generate<quiet, king>() {
-	U64 mvs = (bitboards::kmask[kings[0]] & empty);
-	if (mvs != 0ULL) encode<quiet>(mvs, kings[0]);
+	U64 mvs = (bitboards::kmask[ksq] & empty);
+	if (mvs != 0ULL) encode<quiet>(mvs, ksq);
 }
 
 
 template<>
 inline void Movegen::generate<castles, king>() {
-	if (can_castle_ks) list[last++].set(kings[0], (us == white ? G1 : G8), castle_ks);
-	if (can_castle_qs) list[last++].set(kings[0], (us == white ? C1 : C8), castle_qs);
+	if (can_castle_ks) list[last++] = Move(ksq, (us == white ? G1 : G8), castle_ks);
+	if (can_castle_qs) list[last++] = Move(ksq, (us == white ? C1 : C8), castle_qs);
 }
 
 
 template<>
 inline void Movegen::generate<capture, king>() {
-	U64 mvs = (bitboards::kmask[kings[0]] & enemies);
-	if (mvs != 0ULL) encode<capture>(mvs, kings[0]);
+	U64 mvs = (bitboards::kmask[ksq] & enemies);
+	if (mvs != 0ULL) encode<capture>(mvs, ksq);
 }
 
 //------------------------------
@@ -547,6 +561,92 @@ inline void Movegen::generate<capture, pieces>() {
 	}
 }
 
+//------------------------------
+// quiet checks
+//------------------------------
+template<Piece p>
+inline void Movegen::slider_checks(U64 pcs, const U64& check_sqs) {
+	for (U64 b = pcs; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		// cannot reach a check square even on an empty board, skip the attack lookup
+		if ((bitboards::kchecks[p][s] & check_sqs) == 0ULL) continue;
+		U64 mvs = 0ULL;
+		if constexpr (p == queen) mvs = magics::attacks<bishop>(all_pieces, s) | magics::attacks<rook>(all_pieces, s);
+		else mvs = magics::attacks<p>(all_pieces, s);
+		mvs &= check_sqs;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
+	}
+}
+
+/// <summary>
+/// Quiet (non-promotion, non-castle) moves giving check, for the first qsearch ply.
+/// Direct checks land on the check squares of the piece type (the enemy king attacked "in reverse",
+/// bitboards::kchecks bounds the slider lines), discovered check candidates play every move leaving the line to the king.
+/// </summary>
+template<>
+inline void Movegen::generate<quiet_check, pieces>() {
+	if (check_target != 0ULL) return; // evasions are generated as quiets / captures
+
+	U64 bchecks = magics::attacks<bishop>(all_pieces, eks) & empty;
+	U64 rchecks = magics::attacks<rook>(all_pieces, eks) & empty;
+	U64 nchecks = bitboards::kchecks[knight][eks] & empty;
+	U64 pchecks = bitboards::pattks[them][eks] & empty;
+
+	// discovered checks : every move leaving the line to the king, moves along the line
+	// only when the piece checks directly from its new square (e.g. a queen shielding a rook on a file)
+	for (U64 b = dc_candidates; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = 0ULL;
+		U64 direct = 0ULL;
+		U64 sq = bitboards::squares[s];
+		if (pawns & sq) {
+			U64 single = 0ULL, dbl = 0ULL;
+			U64 saved = pawns;
+			pawns = sq;
+			pawn_quiets(single, dbl);
+			pawns = saved;
+			for (U64 t = single | dbl; t != 0ULL; ) {
+				Square to = Square(bits::pop_lsb(t));
+				if (!util::aligned(s, to, eks) || (pchecks & bitboards::squares[to])) list[last++] = Move(s, to, quiet);
+			}
+			continue;
+		}
+		if (knights & sq) mvs = bitboards::nmask[s];
+		else if (bishops & sq) { mvs = magics::attacks<bishop>(all_pieces, s); direct = bchecks; }
+		else if (rooks & sq) { mvs = magics::attacks<rook>(all_pieces, s); direct = rchecks; }
+		else if (queens & sq) { mvs = magics::attacks<bishop>(all_pieces, s) | magics::attacks<rook>(all_pieces, s); direct = bchecks | rchecks; }
+		else mvs = bitboards::kmask[s]; // king, its moves are checked for legality like all others
+		mvs &= empty;
+		for (U64 t = mvs; t != 0ULL; ) {
+			Square to = Square(bits::pop_lsb(t));
+			if (!util::aligned(s, to, eks) || (direct & bitboards::squares[to])) list[last++] = Move(s, to, quiet);
+		}
+	}
+
+	// direct checks (discovered check candidates were handled above)
+	if (pchecks != 0ULL) {
+		U64 single = 0ULL, dbl = 0ULL;
+		U64 saved = pawns;
+		pawns &= ~dc_candidates;
+		pawn_quiets(single, dbl);
+		pawns = saved;
+		single &= pchecks;
+		dbl &= pchecks;
+		int d1 = (us == white ? -8 : 8);
+		if (single != 0ULL) encode_pawn_pushes<quiet>(single, d1);
+		if (dbl != 0ULL) encode_pawn_pushes<quiet>(dbl, 2 * d1);
+	}
+
+	for (U64 b = knights & ~dc_candidates; b != 0ULL; ) {
+		Square s = Square(bits::pop_lsb(b));
+		U64 mvs = bitboards::nmask[s] & nchecks;
+		if (mvs != 0ULL) encode<quiet>(mvs, s);
+	}
+	slider_checks<bishop>(bishops & ~dc_candidates, bchecks);
+	slider_checks<rook>(rooks & ~dc_candidates, rchecks);
+	slider_checks<queen>(queens & ~dc_candidates, bchecks | rchecks);
+}
+
 //------------------------------
 // pseudo-legal all
 //------------------------------
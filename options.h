@@ -51,11 +51,23 @@ public:
 		else opts[key] = vs;
 	}
 
+	inline void set(const std::string key, const std::string& value) {
+		std::unique_lock<std::mutex> lock(m);
+		opts[key] = value;
+	}
+
 	bool read_param_file(std::string& filename);
 	bool save_param_file(std::string& filename);
 	void set_engine_params();
 };
 
+// string options are kept whole (paths may contain spaces)
+template<>
+inline std::string options::value<std::string>(const char* s) {
+	std::unique_lock<std::mutex> lock(m);
+	return opts[std::string{ s }];
+}
+
 inline void options::load_args(int argc, char* argv[]) {
 
 	//read_param_file(std::string("engine.conf"));
@@ -68,6 +80,10 @@ inline void options::load_args(int argc, char* argv[]) {
 		if (matches(key, "-threads")) set(key, val);
 		else if (matches(key, "-book")) set(key, val);
 		else if (matches(key, "-hashsize")) set(key, val);
+		else if (matches(key, "-pawnhash")) set(key, val);
+		else if (matches(key, "-moveoverhead")) set(key, val);
+		else if (matches(key, "-syzygypath")) set(key, val);
+		else if (matches(key, "-sliders")) set(key, val);
 		else if (matches(key, "-tune")) set(key, val);
 		else if (matches(key, "-bench")) set(key, val);
 		else if (matches(key, "-param"))
@@ -89,6 +105,15 @@ inline void options::load_args(int argc, char* argv[]) {
 
 	if (opts.find("hashsize") == opts.end())
 		set(std::string("-hashsize"), std::string("1000"));
+
+	if (opts.find("pawnhash") == opts.end())
+		set(std::string("-pawnhash"), std::string("4"));
+
+	if (opts.find("moveoverhead") == opts.end())
+		set(std::string("-moveoverhead"), std::string("30"));
+
+	if (opts.find("syzygypath") == opts.end())
+		set(std::string("-syzygypath"), std::string("<empty>"));
 }
 
 
@@ -186,6 +211,20 @@ inline void options::set_engine_params() {
 		else if (matches(p.first, "king s7")) Parameters.king_safe_sqs[6] = value<float>("king s7");
 		else if (matches(p.first, "king s8")) Parameters.king_safe_sqs[7] = value<float>("king s8");
 		else if (matches(p.first, "fixed_depth")) Parameters.fixed_depth = value<int>("fixed_depth");
+		else if (matches(p.first, "qsearch checks")) Parameters.qsearch_checks = value<int>("qsearch checks") != 0;
+		else if (matches(p.first, "rfp margin")) Parameters.rfp_margin = value<float>("rfp margin");
+		else if (matches(p.first, "rfp depth")) Parameters.rfp_depth = value<float>("rfp depth");
+		else if (matches(p.first, "lmr hist")) Parameters.lmr_history_divisor = value<float>("lmr hist");
+		else if (matches(p.first, "lmr cut")) Parameters.lmr_cut_node = value<float>("lmr cut");
+		else if (matches(p.first, "hist prune depth")) Parameters.history_prune_depth = value<float>("hist prune depth");
+		else if (matches(p.first, "hist prune margin")) Parameters.history_prune_margin = value<float>("hist prune margin");
+		else if (matches(p.first, "singular depth")) Parameters.singular_depth = value<float>("singular depth");
+		else if (matches(p.first, "singular margin")) Parameters.singular_margin = value<float>("singular margin");
+		else if (matches(p.first, "probcut depth")) Parameters.probcut_depth = value<float>("probcut depth");
+		else if (matches(p.first, "probcut margin")) Parameters.probcut_margin = value<float>("probcut margin");
+		else if (matches(p.first, "iid depth")) Parameters.iid_depth = value<float>("iid depth");
+		else if (matches(p.first, "iid reduction")) Parameters.iid_reduction = value<float>("iid reduction");
+		else if (matches(p.first, "iir depth")) Parameters.iir_depth = value<float>("iir depth");
 	}
 }
 
@@ -16,21 +16,31 @@ namespace haVoc {
 
 
 	//---------------- Sorting lambdas ---------------//
+	// captures that hold up in the exchange (see >= 0) by victim then attacker (mvv-lva),
+	// losing captures below the cutoff by how much material they risk
+	inline Score capture_score(const position& p, const Move& m) {
+		const Movetype t = Movetype(m.type);
+		const Piece victim = p.piece_on(Square(m.t));
+		int v = (t == Movetype::ep ? mvals[pawn] : victim == no_piece ? 0 : mvals[victim]);
+		if (t <= Movetype::capture_promotion_n) v += mvals[queen - (t & 3)];
+		const int a = mvals[p.piece_on(Square(m.f))];
+		return Score(p.see_ge(m, 0) ? 10 * v - a : std::min(v - a, -1));
+	}
+
 	Score score_captures(const position& p, const Move& m, const Move& prev, const Move& followup, const Move& threat, node* stack) {
-		Score s = Score(p.see(m));
+		Score s = capture_score(p, m);
 		s = Score(s + stack->bestMoveHistory->bm[p.to_move()][m.f][m.t]);
 		return s;
 	}
 
 	Score score_qcaptures(const position& p, const Move& m, const Move& prev, const Move& followup, const Move& threat, node* stack) {
-		Score s = Score(p.see(m));
-		return s;
+		return capture_score(p, m);
 	}
 
 	Score score_quiets(const position& p, const Move& m, const Move& prev, const Move& followup, const Move& threat, node* stack) {
 		auto tomove = p.to_move();
 		auto stats = p.history_stats();
-		auto s = Score(stats->score(m, (Color)(tomove), prev, followup, threat));
+		auto s = Score(stats->score(m, (Color)(tomove), prev, followup, threat) + stats->continuation_score(p, stack, m));
 		s = Score(s + stack->bestMoveHistory->bm[tomove][m.f][m.t]);
 
 		// Use a LUT to order quiet moves without any history data
@@ -52,22 +62,62 @@ namespace haVoc {
 	Movehistory& Movehistory::operator=(const Movehistory& mh) {
 		std::copy(std::begin(mh.history), std::end(mh.history), std::begin(history));
 		std::copy(std::begin(mh.counters), std::end(mh.counters), std::begin(counters));
+		if (mh.continuation) continuation = std::make_unique<Continuationhistory>(*mh.continuation);
+		else continuation.reset();
 		return (*this);
 	}
 
+	void Movehistory::update_continuation(const position& p, const node* stack, const Move& m, const int& bonus) {
+		if (!continuation)
+			continuation = std::make_unique<Continuationhistory>();
+
+		const Color c = p.to_move();
+		const int idx = Continuationhistory::index(c, p.piece_on(Square(m.f)));
+		for (int i = 1; i <= 2; ++i) {
+			const node* prev = stack - i;
+			if (prev->moved == Piece::no_piece) continue; // null move or no move yet
+			const Color pc = (i == 1 ? Color(c ^ 1) : c);
+			Continuationhistory::update(continuation->at(pc, prev->moved, Square(prev->curr_move.t))[idx][m.t], bonus);
+		}
+	}
+
+	int Movehistory::continuation_score(const position& p, const node* stack, const Move& m) const {
+		if (!continuation)
+			return 0;
+
+		const Color c = p.to_move();
+		const int idx = Continuationhistory::index(c, p.piece_on(Square(m.f)));
+		int score = 0;
+		for (int i = 1; i <= 2; ++i) {
+			const node* prev = stack - i;
+			if (prev->moved == Piece::no_piece) continue;
+			const Color pc = (i == 1 ? Color(c ^ 1) : c);
+			score += continuation->at(pc, prev->moved, Square(prev->curr_move.t))[idx][m.t];
+		}
+		return score;
+	}
+
 	void Movehistory::update(const position& p,
 		const Move& m,
-		const Move& previous,
+		const node* stack,
 		const int16& depth,
 		const Score& eval,
 		const std::vector<Move>& quiets,
 		Move* killers) {
 
 		const Color c = p.to_move();
+		const Move& previous = (stack - 1)->curr_move;
 		int score = pow(depth, 2);
 		if (m.type == Movetype::quiet) {
 			history[c][m.f][m.t] += score;
 			counters[previous.f][previous.t] = m;
+
+			// the best quiet move gains, the quiets searched before it lose
+			const int bonus = std::min(score, 1600);
+			update_continuation(p, stack, m, bonus);
+			for (auto& q : quiets)
+				if (q != m) update_continuation(p, stack, q, -bonus);
+
 			if (eval < Score::mate_max_ply &&
 				m != killers[2] &&
 				m != killers[3] &&
@@ -92,6 +142,7 @@ namespace haVoc {
 	}
 
 	void Movehistory::clear() {
+		continuation.reset();
 		for (auto& v : history) { for (auto& w : v) { std::fill(w.begin(), w.end(), 0); } }
 
 		Move empty; empty.set(0, 0, Movetype::no_type);
@@ -116,15 +167,6 @@ namespace haVoc {
 		return score;
 	}
 
-	//---------------- Scored move impl ---------------//
-	ScoredMove& ScoredMove::operator=(const ScoredMove& o) {
-		this->m = o.m;
-		this->s = o.s;
-		return *this;
-	}
-
-
-
 	//---------------- Scored moves array ---------------//
 	void ScoredMoves::load_and_score(const position& p, Movegen* moves, const std::vector<Move>& filters, const Move& previous, const Move& followup, const Move& threat, node* stack, ScoreFunc score_lambda)
 	{
@@ -299,14 +341,18 @@ namespace haVoc {
 	//---------------- QMoveorder impl ---------------//
 	QMoveorder::QMoveorder() { }
 
-	QMoveorder::QMoveorder(position& p, Move& hashmove, node* stack) : Moveorder(p, hashmove, stack) { }
+	QMoveorder::QMoveorder(position& p, Move& hashmove, node* stack, bool checks) : Moveorder(p, hashmove, stack) {
+		m_checks = checks && !m_incheck;
+	}
 
 
 	bool QMoveorder::next_move(position& pos, Move& m, const Move& previous, const Move& followup, const Move& threat, bool skipQuiets, bool rootMoves) {
 		m = {};
 		switch (m_phase) {
 		case HashMove:
-			if (valid_qmove(_killerMoves[0]) && _killerMoves[0].type != Movetype::no_type)
+			// a quiet hash move is tried first when checks are generated (qsearch keeps it only if it checks)
+			if ((valid_qmove(_killerMoves[0]) || (m_checks && _killerMoves[0].type == Movetype::quiet)) &&
+				_killerMoves[0].type != Movetype::no_type)
 				m = _killerMoves[0];
 			break;
 		case MateKiller1:
@@ -343,6 +389,16 @@ namespace haVoc {
 				m_movegen->generate<quiet, pieces>();
 				m_quiets = std::make_shared<ScoredMoves>(pos, m_movegen.get(), _killerMoves, previous, followup, threat, m_stack, score_quiets, Score::draw);
 			}
+			else if (m_checks) {
+				// quiet killers were not played by this orderer, only filter what was
+				std::vector<Move> played(_killerMoves);
+				for (size_t i = 1; i < played.size(); ++i)
+					if (!valid_qmove(played[i])) played[i] = Move();
+
+				m_movegen->reset();
+				m_movegen->generate<quiet_check, pieces>();
+				m_quiets = std::make_shared<ScoredMoves>(pos, m_movegen.get(), played, previous, followup, threat, m_stack, score_quiets, Score::draw);
+			}
 			else 
 				m_quiets = std::make_shared<ScoredMoves>();
 			break;
@@ -18,29 +18,57 @@ class Movegen;
 namespace haVoc {
 
 
+	/// <summary>
+	/// Continuation history : quiet move scores keyed by an earlier move of the line (its piece and destination)
+	/// and the piece and destination of the move itself. One ply back this is counter-move history,
+	/// two plies back follow-up history. Entries are kept within +-bound by the gravity update.
+	/// </summary>
+	struct Continuationhistory {
+		static const int bound = 16384;
+		typedef std::array<std::array<int16, squares>, 2 * pieces> row; // [color * pieces + piece][to]
+		std::array<std::array<row, squares>, 2 * pieces> table; // [color * pieces + piece][to] of the earlier move
+
+		static inline int index(const Color& c, const Piece& p) { return int(c) * pieces + int(p); }
+		inline row& at(const Color& c, const Piece& p, const Square& to) { return table[index(c, p)][to]; }
+		inline const row& at(const Color& c, const Piece& p, const Square& to) const { return table[index(c, p)][to]; }
+
+		// bonuses shrink as the entry approaches the bound
+		static inline void update(int16& v, const int& bonus) {
+			v = int16(v + bonus - v * std::abs(bonus) / bound);
+		}
+	};
+
+
 	struct Movehistory {
 	private:
 		std::array<std::array<std::array<int, squares>, squares>, colors> history;
 		std::array<std::array<Move, squares>, squares> counters;
+		std::unique_ptr<Continuationhistory> continuation; // allocated on the first update (1.2 mb)
 		float counter_move_bonus = 1.0f;
 		float threat_evasion_bonus = 1.0f;
 
+		void update_continuation(const position& p, const node* stack, const Move& m, const int& bonus);
+
 	public:
 		Movehistory() { 
 			clear(); 
 		}
+		Movehistory(const Movehistory& mh) { *this = mh; }
 
 		Movehistory& operator=(const Movehistory& mh);
 		
 		void update(const position& p,
 			const Move& m,
-			const Move& previous,
+			const node* stack,
 			const int16& depth,
 			const Score& eval,
 			const std::vector<Move>& quiets,
 			Move* killers);
 
 		void clear();
+
+		// continuation history of a quiet move at the node 'stack' (1 and 2 plies back)
+		int continuation_score(const position& p, const node* stack, const Move& m) const;
 		
 		int score(const Move& m, 
 			const Color& color,
@@ -51,17 +79,22 @@ namespace haVoc {
 		int score(const Move& m, const Color& c) const;
 	};
 
+	/// <summary>
+	/// Move and its ordering score packed into 32 bits (score saturated to 16 bits).
+	/// </summary>
 	struct ScoredMove {
 		ScoredMove() : m(Move{}), s(Score::ninf) { }
-		ScoredMove(Move& mv, Score& sc) : m(mv), s(sc) { }
-		ScoredMove(Move&& mv, Score&& sc) : m(mv), s(sc) { }
+		ScoredMove(const Move& mv, const Score& sc) : m(mv), s(clamp(sc)) { }
 		Move m;
-		Score s;
-		bool operator>(const ScoredMove& o) { return s > o.s; }
-		bool operator<(const ScoredMove& o) { return s < o.s; }
-		ScoredMove& operator=(const ScoredMove& o);
+		int16 s;
+		bool operator>(const ScoredMove& o) const { return s > o.s; }
+		bool operator<(const ScoredMove& o) const { return s < o.s; }
+
+		static inline int16 clamp(const int& sc) { return int16(std::max(-32767, std::min(32767, sc))); }
 	};
 
+	static_assert(sizeof(ScoredMove) == 4, "scored moves are packed into 32 bits");
+
 
 	typedef std::function<Score(const position& p, const Move& m, const Move& prev, const Move& followup, const Move& threat, node* stack )> ScoreFunc;
 	
@@ -133,13 +166,14 @@ namespace haVoc {
 	protected:
 		enum Phase { HashMove, MateKiller1, MateKiller2,  InitCaptures, GoodCaptures, Killer1, Killer2, BadCaptures, InitQuiets, GoodQuiets, BadQuiets, End };
 		Phase m_phase = HashMove;
+		bool m_checks = false; // quiet checks after the captures (first qsearch ply)
 
 		bool valid_qmove(const Move& m);
 		void next_phase() override;
 
 	public:
 		QMoveorder();
-		QMoveorder(position& p, Move& hashmove, node* stack);
+		QMoveorder(position& p, Move& hashmove, node* stack, bool checks = false);
 		QMoveorder(const QMoveorder& mo) = delete;
 		QMoveorder(const QMoveorder&& mo) = delete;
 		QMoveorder& operator=(const QMoveorder& o) = delete;
@@ -23,15 +23,15 @@ protected:
 
 public:
 
-	parameter<T>(T&& in, std::string& s) : tag(s)
+	parameter(T&& in, std::string& s) : tag(s)
 	{
 		value = util::make_unique<T>(in);
 		bits = *reinterpret_cast<unsigned long*>(value.get());
 	}
-	parameter<T>(T& in, std::string& s) : tag(s) { set(in); }
-	parameter<T>(T& in) : tag("") { set(in); }
-	parameter<T>(const parameter<T>& o) { tag = o.tag;  set(*o.value); }
-	virtual ~parameter<T>() {}
+	parameter(T& in, std::string& s) : tag(s) { set(in); }
+	parameter(T& in) : tag("") { set(in); }
+	parameter(const parameter<T>& o) { tag = o.tag;  set(*o.value); }
+	virtual ~parameter() {}
 
 	parameter<T>& operator=(const parameter<T>& o) { tag = o.tag; set(*o.value); }
 	T& operator()() { return *value; }
@@ -70,6 +70,20 @@ struct parameters {
 		uncastled_penalty = o.uncastled_penalty;
 		pinned_scaling = o.pinned_scaling;
 		fixed_depth = o.fixed_depth;
+		qsearch_checks = o.qsearch_checks;
+		rfp_margin = o.rfp_margin;
+		rfp_depth = o.rfp_depth;
+		lmr_history_divisor = o.lmr_history_divisor;
+		lmr_cut_node = o.lmr_cut_node;
+		history_prune_depth = o.history_prune_depth;
+		history_prune_margin = o.history_prune_margin;
+		singular_depth = o.singular_depth;
+		singular_margin = o.singular_margin;
+		probcut_depth = o.probcut_depth;
+		probcut_margin = o.probcut_margin;
+		iid_depth = o.iid_depth;
+		iid_reduction = o.iid_reduction;
+		iir_depth = o.iir_depth;
 		return *this;
 	}
 
@@ -136,6 +150,7 @@ struct parameters {
 	const float isolated_pawn_penalty = 4.0f;
 	const float passed_pawn_bonus = 2.0f;
 	const float semi_open_pawn_penalty = 1.0f;
+	const float space_bonus = 1.0f; // per safe central square behind our pawns
 
 	// move ordering
 	const float counter_move_bonus = 5; // 100.0f; // 5
@@ -143,6 +158,22 @@ struct parameters {
 
 	// search params 
 	int fixed_depth = -1;
+	bool qsearch_checks = true; // quiet checks at the first qsearch ply
+
+	// pruning and reductions (floats so they can be tuned like the eval terms)
+	float rfp_margin = 100.0f; // reverse futility : static eval - margin * depth >= beta
+	float rfp_depth = 6.0f;
+	float lmr_history_divisor = 512.0f; // one ply of reduction per divisor of quiet history
+	float lmr_cut_node = 1.0f; // extra reduction at expected cut nodes
+	float history_prune_depth = 3.0f; // quiets with history < -margin * depth are skipped
+	float history_prune_margin = 64.0f;
+	float singular_depth = 8.0f; // min depth of the singular extension test of the tt move
+	float singular_margin = 2.0f; // the alternatives are searched against tt score - margin * depth
+	float probcut_depth = 5.0f; // min depth of the probcut capture search
+	float probcut_margin = 200.0f; // captures are searched against beta + margin
+	float iid_depth = 8.0f; // pv nodes without a hash move search depth - iid reduction first
+	float iid_reduction = 4.0f;
+	float iir_depth = 8.0f; // cut nodes without a hash move are searched a ply shallower
 
 	const float pawn_lever_score[64] =
 	{
@@ -1,5 +1,7 @@
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 
 #include "pawns.h"
 #include "types.h"
@@ -11,253 +13,192 @@
 
 
 
-
-template<Color c>
-int16 evaluate(const position& p, pawn_entry& e);
-
 inline size_t pow2(size_t x) {
 	return x <= 2 ? x : pow2(x >> 1) << 1;
 }
 
 pawn_table::pawn_table() : sz_mb(0), count(0) {
-	init();
+	resize(default_pawn_table_mb);
 }
 
 pawn_table::pawn_table(const pawn_table& o) {
-	entries = std::shared_ptr<pawn_entry[]>(new pawn_entry[count]());
-	std::memcpy(entries.get(), o.entries.get(), count * sizeof(pawn_entry));
-	sz_mb = o.sz_mb;
-	count = o.count;
+	*this = o;
 }
 
 pawn_table& pawn_table::operator=(const pawn_table& o) {
-	entries = std::shared_ptr<pawn_entry[]>(new pawn_entry[count]());
-	std::memcpy(entries.get(), o.entries.get(), count * sizeof(pawn_entry));
+	if (this == &o)
+		return *this;
 	sz_mb = o.sz_mb;
 	count = o.count;
+	entries = std::unique_ptr<pawn_entry[]>(new pawn_entry[count]());
+	std::memcpy(entries.get(), o.entries.get(), count * sizeof(pawn_entry));
+	probes = o.probes;
+	hits = o.hits;
 	return *this;
 }
 
-void pawn_table::init() {
-	sz_mb = 10 * 1024; // todo : input mb parameter
-	count = 1024 * sz_mb / sizeof(pawn_entry);
+void pawn_table::resize(size_t sizeMb) {
+	sz_mb = std::max(sizeMb, size_t(1));
+	count = 1024 * 1024 * sz_mb / sizeof(pawn_entry);
 	count = pow2(count);
 	count = (count < 1024 ? 1024 : count);
-	entries = std::shared_ptr<pawn_entry[]>(new pawn_entry[count]());
+	entries = std::unique_ptr<pawn_entry[]>(new pawn_entry[count]());
 	clear();
 }
 
 
 
 void pawn_table::clear() {
-	memset(entries.get(), 0, count * sizeof(pawn_entry));
+	std::fill(entries.get(), entries.get() + count, pawn_entry{});
+	clear_stats();
 }
 
 
 
 pawn_entry* pawn_table::fetch(const position& p) const {
 	U64 k = p.pawnkey();
-	unsigned idx = k & (count - 1);
+	size_t idx = k & (count - 1);
+	++probes;
 	if (entries[idx].key == k) {
+		++hits;
 		return &entries[idx];
 	}
 	else {
-		std::memset(&entries[idx], 0, sizeof(pawn_entry));
+		pawns::evaluate(p, entries[idx]);
 		entries[idx].key = k;
-		entries[idx].score = evaluate<white>(p, entries[idx]) - evaluate<black>(p, entries[idx]);
 		return &entries[idx];
 	}
 }
 
 
+// file masks used to keep shifted pawn sets from wrapping around the board edges
+const U64 not_a_file = 0xFEFEFEFEFEFEFEFEULL;
+const U64 not_h_file = 0x7F7F7F7F7F7F7F7FULL;
+
 template<Color c>
-inline bool backward_pawn(const int& row, const int& col, const U64& pawns) {
-	int left = col - 1 < Col::A ? -1 : col - 1;
-	int right = col + 1 > Col::H ? -1 : col + 1;
-	bool left_greater = false;
-	bool right_greater = false;
+inline U64 forward(const U64& b) {
+	return (c == white ? b << 8 : b >> 8);
+}
 
+// set including the origin squares and every square in front of them (from c's point of view)
+template<Color c>
+inline U64 front_fill(U64 b) {
 	if (c == white) {
-		if (left != -1) {
-			int sq = -1;
-			U64 left_pawns = bitboards::col[left] & pawns;
-			while (left_pawns) {
-				int tmp = bits::pop_lsb(left_pawns);
-				if (tmp > sq) sq = tmp;
-			}
-			left_greater = sq > 0 && util::row(sq) > row;
-		}
-
-		if (right != -1) {
-			int sq = -1;
-			U64 right_pawns = bitboards::col[right] & pawns;
-			bool no_right_pawns = (right_pawns == 0ULL);
-			while (right_pawns) {
-				int tmp = bits::pop_lsb(right_pawns);
-				if (tmp > sq) sq = tmp;
-			}
-			right_greater = sq > 0 && util::row(sq) > row || no_right_pawns;
-		}
+		b |= b << 8; b |= b << 16; b |= b << 32;
 	}
 	else {
-		if (left != -1) {
-			int sq = 100;
-			U64 left_pawns = bitboards::col[left] & pawns;
-			bool no_left_pawns = (left_pawns == 0ULL);
-			while (left_pawns) {
-				int tmp = bits::pop_lsb(left_pawns);
-				if (tmp < sq) sq = tmp;
-			}
-			left_greater = sq < 100 && util::row(sq) < row || no_left_pawns;
-		}
-		if (right != -1) {
-			int sq = 100;
-			U64 right_pawns = bitboards::col[right] & pawns;
-			bool no_right_pawns = (right_pawns == 0ULL);
-			while (right_pawns) {
-				int tmp = bits::pop_lsb(right_pawns);
-				if (tmp < sq) sq = tmp;
-			}
-			right_greater = sq < 100 && util::row(sq) < row || no_right_pawns;
-		}
+		b |= b >> 8; b |= b >> 16; b |= b >> 32;
 	}
+	return b;
+}
+
+// squares strictly in front of the set
+template<Color c>
+inline U64 front_span(const U64& b) {
+	return forward<c>(front_fill<c>(b));
+}
+
+inline U64 file_fill(const U64& b) {
+	return front_fill<white>(b) | front_fill<black>(b);
+}
+
+inline U64 adjacent_files(const U64& b) {
+	return ((b & not_h_file) << 1) | ((b & not_a_file) >> 1);
+}
 
-	return (left == -1 && right_greater) ||
-		(right == -1 && left_greater) ||
-		(left_greater && right_greater);
+template<Color c>
+inline U64 pawn_attacks(const U64& b) {
+	return (c == white ?
+		((b & not_h_file) << 9) | ((b & not_a_file) << 7) :
+		((b & not_a_file) >> 9) | ((b & not_h_file) >> 7));
 }
 
 // sq score scale factors by column
 std::vector<float> pawn_scaling{ 0.86f, 0.90f, 0.95f, 1.00f, 1.00f, 0.95f, 0.90f, 0.86f };
 std::vector<float> material_vals{ 100.0f, 300.0f, 315.0f, 480.0f, 910.0f };
 
+/// <summary>
+/// Pawn structure of one side computed over whole bitboards (no per-pawn scans).
+/// Only the material/square-table term still visits individual pawns.
+/// </summary>
 template<Color c>
-int16 evaluate(const position& p, pawn_entry& e) {
-
-	Color them = Color(c ^ 1);
-
-	U64 pawns = p.get_pieces<c, pawn>();
-	U64 epawns = them == white ?
-		p.get_pieces<white, pawn>() :
-		p.get_pieces<black, pawn>();
-
-	Square* sqs = p.squares_of<c, pawn>();
-
-	Square ksq = p.king_square(c);
-
-	int16 score = 0;
-	U64 locked_bb = 0ULL;
-
-	for (Square s = *sqs; s != no_square; s = *++sqs) {
-
-		U64 fbb = bitboards::squares[s];
-		U64 front = (c == white ? bitboards::squares[s + 8] : bitboards::squares[s - 8]);
-		int row = util::row(s);
-		int col = util::col(s);
-
-		score += p.params.sq_score_scaling[pawn] * square_score<c>(pawn, Square(s));
-		score += pawn_scaling[col] * material_vals[pawn];
-
-
-		// Pawn attacks
-		e.attacks[c] |= bitboards::pattks[c][s];
-
-		// Track undefended pawns
-		auto defend_mask = (c == white ? bitboards::pattks[black][s] : bitboards::pattks[white][s]);
-		auto defenders = pawns & defend_mask;
-		if (defenders == 0ULL) {
-			score -= 1;
-			e.undefended[c] |= fbb;
-		}
-
-		// King shelter
-		if ((bitboards::kmask[ksq] & fbb)) {
-			e.king[c] |= fbb;
-		}
-
-		// Track passed pawns
-		U64 mask = bitboards::passpawn_mask[c][s] & epawns;
-		if (mask == 0ULL) {
-			e.passed[c] |= fbb;
-			e.score += p.params.passed_pawn_bonus;
-			e.weak_squares[c] |= front;
-		}
-
-		// Track isolated pawns
-		U64 neighbors_bb = bitboards::neighbor_cols[col] & pawns;
-		if (neighbors_bb == 0ULL) {
-			e.isolated[c] |= fbb;
-			score -= p.params.isolated_pawn_penalty;
-			e.weak_squares[c] |= front;
-		}
-
-		// Track backward pawns
-		if (backward_pawn<c>(row, col, pawns)) {
-			e.backward[c] |= fbb;
-			score -= p.params.backward_pawn_penalty;
-			e.weak_squares[c] |= front;
-		}
-
-		// Sort pawns by square color
-		U64 wsq = bitboards::colored_sqs[white] & fbb;
-		if (wsq) e.light[c] |= fbb;
-		U64 bsq = bitboards::colored_sqs[black] & fbb;
-		if (bsq) e.dark[c] |= fbb;
-
-		// Track doubled pawns
-		U64 doubled = bitboards::col[col] & pawns;
-		if (bits::more_than_one(doubled)) {
-			e.doubled[c] |= doubled;
-			if (e.isolated[c] & doubled)
-				score -= 2 * p.params.doubled_pawn_penalty;
-			else score -= p.params.doubled_pawn_penalty;
-		}
-
-		// Track pawns on semi-open files
-		U64 column = bitboards::col[col];
-		if ((column & epawns) == 0ULL) {
-			e.semiopen[c] |= fbb;
-			if ((fbb & e.backward[c])) 
-				score -= 2 * p.params.backward_pawn_penalty;
-			if ((fbb & e.isolated[c]))
-				score -= 2 * p.params.isolated_pawn_penalty;
-			if ((fbb && e.doubled[c]))
-				score -= 2 * p.params.doubled_pawn_penalty;
-			e.weak_squares[c] |= front;
-		}
-
-		// Track king/queen side pawn configurations
-		if (util::col(s) <= Col::D) 
-			e.qsidepawns[c] |= fbb;
-		else 
-			e.ksidepawns[c] |= fbb;
-
-		// .. locked center pawns
-		// count nb of center pawns while computing this too
-		// e.g. french advanced, caro-kahn advanced, 4-pawns attack in KID etc.
-		// favors flank attacks, knights, and small penalties for bishop
-		if ((bitboards::squares[s] & bitboards::small_center_mask) != 0ULL) {
-			Square front_sq = Square(c == white ? s + 8 : s - 8);
-			if (util::on_board(front_sq)) {
-				U64 fbb = bitboards::squares[front_sq];
-				e.center_pawn_count++;
-				if ((epawns & fbb)) {
-					locked_bb |= fbb;
-				}
-			}
-		}
-		
-		// pawn islands
-		// pawn chain tips
-		// pawn chain bases
-		// pawn majorities
+int16 eval_pawns(const position& p, pawn_entry& e) {
+
+	const Color them = Color(c ^ 1);
+
+	const U64 pawns = p.get_pieces<c, pawn>();
+	const U64 epawns = (them == white ? p.get_pieces<white, pawn>() : p.get_pieces<black, pawn>());
+	const U64 eattacks = pawn_attacks<them>(epawns);
+
+	// material and square scores (terms are truncated independently so the sum
+	// does not form one long float/int conversion chain)
+	int sq_score = 0;
+	const float sq_scaling = p.params.sq_score_scaling[pawn];
+	for (U64 b = pawns; b; ) {
+		int s = bits::pop_lsb(b);
+		sq_score += int(sq_scaling * square_score<c>(pawn, Square(s)));
+		sq_score += int(pawn_scaling[util::col(s)] * material_vals[pawn]);
 	}
 
-	// note : evaluated 2x's when we only need to evaluate once
-	// since it is the same per side - but the performance hit should be small
-	if (bits::count(locked_bb) >= 2) {
-		e.locked_center = true;
-	}
+	e.attacks[c] = pawn_attacks<c>(pawns);
+	e.king[c] = pawns & bitboards::kmask[p.king_square(c)];
+	e.light[c] = pawns & bitboards::colored_sqs[white];
+	e.dark[c] = pawns & bitboards::colored_sqs[black];
+	e.qsidepawns[c] = pawns & (bitboards::col[A] | bitboards::col[B] | bitboards::col[C] | bitboards::col[D]);
+	e.ksidepawns[c] = pawns & ~e.qsidepawns[c];
+
+	// pawns not protected by another pawn
+	e.undefended[c] = pawns & ~e.attacks[c];
+
+	// no enemy pawn in front on the same or an adjacent file
+	U64 enemy_span = front_span<them>(epawns);
+	e.passed[c] = pawns & ~(enemy_span | adjacent_files(enemy_span));
+
+	// no friendly pawn on an adjacent file
+	e.isolated[c] = pawns & ~adjacent_files(file_fill(pawns));
+
+	// no friendly pawn on an adjacent file level with or behind it (it can never be supported)
+	// and the stop square is controlled by an enemy pawn
+	U64 supportable = front_fill<c>(adjacent_files(pawns));
+	e.backward[c] = pawns & ~supportable & ~e.isolated[c] & forward<them>(eattacks);
+
+	// another friendly pawn on the same file
+	e.doubled[c] = pawns & (front_span<white>(pawns) | front_span<black>(pawns));
+
+	// no enemy pawn on the same file
+	e.semiopen[c] = pawns & ~file_fill(epawns);
+
+	// squares in front of passed, isolated, backward pawns and pawns on semi-open files
+	e.weak_squares[c] = forward<c>(e.passed[c] | e.isolated[c] | e.backward[c] | e.semiopen[c]);
+
+	float structure = 0;
+	structure -= bits::count(e.undefended[c]);
+	structure += p.params.passed_pawn_bonus * bits::count(e.passed[c]);
+	structure -= p.params.isolated_pawn_penalty * (bits::count(e.isolated[c]) + 2 * bits::count(e.semiopen[c] & e.isolated[c]));
+	structure -= p.params.backward_pawn_penalty * (bits::count(e.backward[c]) + 2 * bits::count(e.semiopen[c] & e.backward[c]));
+	structure -= p.params.doubled_pawn_penalty * (bits::count(e.doubled[c]) + bits::count(e.doubled[c] & e.isolated[c]) +
+		2 * bits::count(e.semiopen[c] & e.doubled[c]));
+
+	// e.g. french advanced, caro-kahn advanced, 4-pawns attack in KID etc.
+	// favors flank attacks, knights, and small penalties for bishop
+	U64 center = pawns & bitboards::small_center_mask;
+	e.center_pawn_count += bits::count(center);
+
+	return int16(sq_score + structure);
+}
+
+
+int16 pawns::evaluate(const position& p, pawn_entry& e) {
+	e = pawn_entry{};
+
+	e.score = eval_pawns<white>(p, e) - eval_pawns<black>(p, e);
+
+	// locked center pawns
+	const U64 wpawns = p.get_pieces<white, pawn>();
+	const U64 bpawns = p.get_pieces<black, pawn>();
+	U64 wlocked = forward<white>(wpawns & bitboards::small_center_mask) & bpawns;
+	U64 blocked = forward<black>(bpawns & bitboards::small_center_mask) & wpawns;
+	e.locked_center = bits::count(wlocked) >= 2 || bits::count(blocked) >= 2;
 
-	return score;
+	return e.score;
 }
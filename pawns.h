@@ -8,11 +8,10 @@
 
 class position;
 
-struct pawn_entry {
-	pawn_entry() : key(0ULL), score(0) { }
-
-	U64 key;
-	int16 score;
+// an aggregate so pawn_entry{} zeroes every member (reset by pawns::evaluate and pawn_table::clear)
+struct alignas(64) pawn_entry {
+	U64 key = 0ULL;
+	int16 score = 0;
 
 	U64 doubled[2];
 	U64 isolated[2];
@@ -37,25 +36,39 @@ struct pawn_entry {
 
 
 
+const size_t default_pawn_table_mb = 4;
+
 class pawn_table {
 private:
 	size_t sz_mb = 0;
 	size_t count = 0;
-	std::shared_ptr<pawn_entry[]> entries;
-
-	void init();
+	std::unique_ptr<pawn_entry[]> entries;
+	mutable U64 probes = 0;
+	mutable U64 hits = 0;
 
 public:
 	pawn_table();
 	pawn_table(const pawn_table& o);
+	pawn_table(pawn_table&& o) noexcept = default;
 	pawn_table& operator=(const pawn_table& o);
+	pawn_table& operator=(pawn_table&& o) noexcept = default;
 	~pawn_table() {}
 
+	void resize(size_t sizeMb);
 	void clear();
+	void clear_stats() { probes = hits = 0; }
 	pawn_entry* fetch(const position& p) const;
+
+	size_t size_mb() const { return sz_mb; }
+	U64 probe_count() const { return probes; }
+	U64 hit_count() const { return hits; }
 };
 
 
+namespace pawns {
+	int16 evaluate(const position& p, pawn_entry& e);
+}
+
 //extern pawn_table ptable; // global pawn hash table
 
 #endif
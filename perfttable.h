@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef PERFTTABLE_H
+#define PERFTTABLE_H
+
+#include <memory>
+#include <cstring>
+
+#include "types.h"
+
+struct perft_entry {
+	U64 key; // position key ^ data, entries written by another thread fail the check
+	U64 data; // subtree count << 8 | depth
+};
+
+
+/// <summary>
+/// Direct-mapped cache of perft subtree counts shared by all perft threads.
+/// Entries are indexed by position key and depth, always-replace, lockless (xor-checked).
+/// </summary>
+class perft_table {
+private:
+	size_t count = 0;
+	std::unique_ptr<perft_entry[]> entries;
+
+	inline size_t index(const U64& key, const int& depth) const {
+		return (key ^ (U64(depth) * 0x9E3779B97F4A7C15ULL)) & (count - 1);
+	}
+
+public:
+	perft_table() {}
+	perft_table(const size_t& sz_mb) { resize(sz_mb); }
+	perft_table(const perft_table& o) = delete;
+	perft_table& operator=(const perft_table& o) = delete;
+	~perft_table() {}
+
+	void resize(const size_t& sz_mb) {
+		count = 0;
+		entries.reset();
+		if (sz_mb == 0) return;
+		size_t n = sz_mb * 1024 * 1024 / sizeof(perft_entry);
+		count = 1;
+		while (count * 2 <= n) count *= 2;
+		entries = std::unique_ptr<perft_entry[]>(new perft_entry[count]());
+	}
+
+	void clear() {
+		if (entries) std::memset(entries.get(), 0, count * sizeof(perft_entry));
+	}
+
+	inline bool enabled() const { return count > 0; }
+
+	inline bool fetch(const U64& key, const int& depth, U64& nodes) const {
+		const perft_entry& e = entries[index(key, depth)];
+		U64 data = e.data;
+		if ((e.key ^ data) != key || int(data & 0xFF) != depth)
+			return false;
+		nodes = data >> 8;
+		return true;
+	}
+
+	inline void save(const U64& key, const int& depth, const U64& nodes) {
+		perft_entry& e = entries[index(key, depth)];
+		U64 data = (nodes << 8) | U64(depth);
+		e.key = key ^ data;
+		e.data = data;
+	}
+};
+
+#endif
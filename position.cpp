@@ -28,15 +28,23 @@ position& position::operator=(const position& p) {
 }
 
 
+// castle rights kept after a move from or to each square (king and rook home squares clear theirs)
+constexpr std::array<U16, Square::squares> castle_mask = [] {
+	std::array<U16, Square::squares> m{};
+	for (auto& v : m) v = U16(wks | wqs | bks | bqs);
+	m[Square::E1] = clearw; m[Square::A1] = clearwqs; m[Square::H1] = clearwks;
+	m[Square::E8] = clearb; m[Square::A8] = clearbqs; m[Square::H8] = clearbks;
+	return m;
+}();
+
+
 piece_data& piece_data::operator=(const piece_data& pd) {
 	std::copy(std::begin(pd.bycolor), std::end(pd.bycolor), std::begin(bycolor));
 	std::copy(std::begin(pd.king_sq), std::end(pd.king_sq), std::begin(king_sq));
-	std::copy(std::begin(pd.color_on), std::end(pd.color_on), std::begin(color_on));
-	std::copy(std::begin(pd.piece_on), std::end(pd.piece_on), std::begin(piece_on));
-	std::copy(std::begin(pd.number_of), std::end(pd.number_of), std::begin(number_of));
+	std::copy(std::begin(pd.mailbox), std::end(pd.mailbox), std::begin(mailbox));
 	std::copy(std::begin(pd.bitmap), std::end(pd.bitmap), std::begin(bitmap));
-	std::copy(std::begin(pd.piece_idx), std::end(pd.piece_idx), std::begin(piece_idx));
-	std::copy(std::begin(pd.square_of), std::end(pd.square_of), std::begin(square_of));
+	material_idx = pd.material_idx;
+	material_overflow = pd.material_overflow;
 	return (*this);
 }
 
@@ -57,18 +65,16 @@ void position::setup(std::istringstream& fen) {
 	// side to move
 	fen >> token;
 	ifo.stm = (token == "w" ? Color::white : Color::black);
-	ifo.key ^= zobrist::stm(ifo.stm);
-	ifo.repkey ^= zobrist::stm(ifo.stm);
+	if (ifo.stm == Color::black) toggle_side_keys();
 
 	// the castle rights
 	fen >> token;
 	ifo.cmask = U16(0);
-	for (auto& c : token) {
-		U16 cr = CastleRights.at(c);
-		ifo.cmask |= cr;
-		ifo.key ^= zobrist::castle(ifo.stm, cr);
-		ifo.repkey ^= zobrist::castle(ifo.stm, cr);
-	}
+	for (auto& c : token) ifo.cmask |= CastleRights.at(c);
+	ifo.key ^= zobrist::castle(ifo.cmask);
+#ifdef HAVOC_KEY128
+	ifo.key2 ^= zobrist::castle2(ifo.cmask);
+#endif
 
 
 	// ep square
@@ -83,22 +89,16 @@ void position::setup(std::istringstream& fen) {
 
 	if (!util::on_board(ifo.eps)) ifo.eps = Square::no_square;
 
-	if (ifo.eps != Square::no_square) {
-		ifo.key ^= zobrist::ep(util::col(ifo.eps));
-		ifo.repkey ^= zobrist::ep(util::col(ifo.eps));
-	}
+	if (ifo.eps != Square::no_square) toggle_ep_keys();
 
 	// half-moves since last pawn move/capture
 	fen >> token;
 
 	ifo.move50 = (token != "-" ? U8(std::stoi(token)) : 0);
 
-	ifo.key ^= zobrist::mv50(ifo.move50);
-
 	// move counter
 	fen >> token;
 	ifo.hmvs = (token != "-" ? U16(std::stoi(token)) : 0);
-	ifo.key ^= zobrist::hmvs(ifo.hmvs);
 
 	// check info
 	Color stm = to_move();
@@ -106,8 +106,7 @@ void position::setup(std::istringstream& fen) {
 	ifo.incheck = is_attacked(ifo.ks[stm], stm, Color(stm ^ 1));
 
 	ifo.checkers = (in_check() ? attackers_of2(ifo.ks[stm], Color(stm ^ 1)) : 0ULL);
-	ifo.pinned[stm] = pinned(stm);
-	ifo.pinned[stm ^ 1] = pinned(Color(stm ^ 1));
+	update_check_info();
 }
 
 
@@ -159,20 +158,56 @@ std::string position::to_fen() const {
 }
 
 
-bool position::is_draw() {
+bool position::is_draw() const {
 
 	if (ifo.move50 > 99) 
 		return true;
 
-	U64 kcurrent = ifo.repkey;
-	unsigned same_count = 0;
-	int idx = hidx - 2;
-	while (same_count == 0 && idx >= 0) {
-		same_count += (kcurrent == history[idx].repkey);
-		idx -= 2;
+	// only positions since the last irreversible (or null) move can repeat, with the same side to move
+	const int end = std::min<int>(ifo.move50, ifo.plies_from_null);
+	for (int i = 4; i <= end; i += 2)
+		if (history[hidx - i].key == ifo.key)
+			return true;
+
+	return false;
+}
+
+
+/// <summary>
+/// True if the side to move has a reversible move reaching a position already on the search path
+/// (a draw it can claim). The key difference to each earlier position is looked up in the cuckoo table
+/// of reversible moves, the move only counts if nothing stands between its squares.
+/// </summary>
+bool position::has_upcoming_repetition(const int& ply) const {
+
+	const int end = std::min<int>(ifo.move50, ifo.plies_from_null);
+	if (end < 3)
+		return false;
+
+	const U64 occ = all_pieces();
+	for (int i = 3; i <= end; i += 2) {
+		const U64 diff = ifo.key ^ history[hidx - i].key;
+
+		unsigned j = zobrist::cuckoo_h1(diff);
+		if (zobrist::cuckoo.keys[j] != diff) {
+			j = zobrist::cuckoo_h2(diff);
+			if (zobrist::cuckoo.keys[j] != diff)
+				continue;
+		}
+
+		const U16 m = zobrist::cuckoo.moves[j];
+		const Square s1 = Square(m & 63);
+		const Square s2 = Square(m >> 6);
+		// between holds both ends for aligned squares and is empty otherwise (knight and king moves)
+		if (bitboards::between[s1][s2] & ~(bitboards::squares[s1] | bitboards::squares[s2]) & occ)
+			continue;
+
+		// positions before the root would need a second repetition, only count the ones inside the tree
+		if (ply > i)
+			return true;
 	}
 
-	return same_count > 0;
+	return false;
 }
 
 
@@ -184,41 +219,20 @@ void position::do_move(const Move& m) {
 	const Piece p = piece_on(from);
 	const Color us = to_move();
 
-	// king square update and castle rights update
+	// king square update
 	if (p == king) {
 		pcs.king_sq[us] = to;
 		ifo.ks[us] = to;
-		if (can_castle_ks() || can_castle_qs()) {
-			ifo.cmask &= (us == white ? clearw : clearb);
-			ifo.key ^= (us == white ? zobrist::castle(white, clearw) : zobrist::castle(black, clearb));
-			ifo.repkey ^= (us == white ? zobrist::castle(white, clearw) : zobrist::castle(black, clearb));
-		}
 	}
-	else if (p == rook) {
-		if (us == white && can_castle<white>()) {
-			if (from == A1) {
-				ifo.cmask &= clearwqs;
-				ifo.key ^= zobrist::castle(white, clearwqs);
-				ifo.repkey ^= zobrist::castle(white, clearwqs);
-			}
-			else if (from == H1) {
-				ifo.cmask &= clearwks;
-				ifo.key ^= zobrist::castle(white, clearwks);
-				ifo.repkey ^= zobrist::castle(white, clearwks);
-			}
-		}
-		else if (us == black && can_castle<black>()) {
-			if (from == A8) {
-				ifo.cmask &= clearbqs;
-				ifo.key ^= zobrist::castle(black, clearbqs);
-				ifo.repkey ^= zobrist::castle(black, clearbqs);
-			}
-			else if (from == H8) {
-				ifo.cmask &= clearbks;
-				ifo.key ^= zobrist::castle(black, clearbks);
-				ifo.repkey ^= zobrist::castle(black, clearbks);
-			}
-		}
+
+	// castle rights, anything moving from or to a king/rook home square clears the matching rights
+	const U16 cmask = ifo.cmask;
+	ifo.cmask &= castle_mask[from] & castle_mask[to];
+	if (ifo.cmask != cmask) {
+		ifo.key ^= zobrist::castle(cmask) ^ zobrist::castle(ifo.cmask);
+#ifdef HAVOC_KEY128
+		ifo.key2 ^= zobrist::castle2(cmask) ^ zobrist::castle2(ifo.cmask);
+#endif
 	}
 
 	ifo.captured = no_piece;
@@ -252,42 +266,37 @@ void position::do_move(const Move& m) {
 
 	else if (t == castle_ks) {
 		pcs.do_castle_ks(us, from, to, ifo);
-		ifo.cmask &= (us == white ? clearw : clearb);
 		ifo.has_castled[us] = true;
 	}
 
 	else if (t == castle_qs) {
 		pcs.do_castle_qs(us, from, to, ifo);
-		ifo.cmask &= (us == white ? clearw : clearb);
 		ifo.has_castled[us] = true;
 	}
 
-	// eps
+	// eps, the previous ep square no longer applies
+	if (ifo.eps != no_square) toggle_ep_keys();
 	ifo.eps = no_square;
 	if (p == pawn && abs(from - to) == 16) {
 		ifo.eps = Square(from + (us == white ? 8 : -8));
-		ifo.key ^= zobrist::ep(util::col(to));
-		ifo.repkey ^= zobrist::ep(util::col(to));
+		toggle_ep_keys();
 	}
 
-	// move50
+	// move50 (not hashed)
 	if (p == pawn || t == capture) ifo.move50 = 0;
 	else ifo.move50++;
-	ifo.key ^= zobrist::mv50(ifo.move50);
 
 	// half-moves
 	ifo.hmvs++;
-	ifo.key ^= zobrist::hmvs(ifo.hmvs);
+	ifo.plies_from_null++;
 
 	// side to move
 	ifo.stm = Color(ifo.stm ^ 1);
-	ifo.key ^= zobrist::stm(ifo.stm);
-	ifo.repkey ^= zobrist::stm(ifo.stm);
+	toggle_side_keys();
 
 	ifo.incheck = is_attacked(king_square(), ifo.stm, us);
 	ifo.checkers = (ifo.incheck ? attackers_of2(king_square(), Color(ifo.stm ^ 1)) : 0ULL);
-	ifo.pinned[ifo.stm] = pinned(ifo.stm);
-	ifo.pinned[ifo.stm ^ 1] = pinned(Color(ifo.stm ^ 1));
+	update_check_info();
 	++nodes_searched;
 }
 
@@ -299,41 +308,41 @@ void position::undo_move(const Move& m) {
 	const Color us = Color(to_move() ^ 1);
 	Piece cp = ifo.captured;
 
-	if (t == quiet) pcs.do_quiet(us, p, from, to, ifo);
+	if (t == quiet) pcs.do_quiet<false>(us, p, from, to, ifo);
 
 	else if (t == capture) {
-		pcs.do_quiet(us, p, from, to, ifo);
-		pcs.add_piece(to_move(), cp, from, ifo);
+		pcs.do_quiet<false>(us, p, from, to, ifo);
+		pcs.add_piece<false>(to_move(), cp, from, ifo);
 	}
 
 	else if (t == ep) {
-		pcs.do_quiet(us, p, from, to, ifo);
-		pcs.add_piece(to_move(), cp, Square(from + (us == white ? -8 : 8)), ifo);
+		pcs.do_quiet<false>(us, p, from, to, ifo);
+		pcs.add_piece<false>(to_move(), cp, Square(from + (us == white ? -8 : 8)), ifo);
 	}
 
 	else if (t < capture_promotion_q) {
-		pcs.remove_piece(us, piece_on(from), from, ifo);
-		pcs.add_piece(us, pawn, to, ifo);
+		pcs.remove_piece<false>(us, piece_on(from), from, ifo);
+		pcs.add_piece<false>(us, pawn, to, ifo);
 	}
 
 	else if (t < castle_ks) {
-		pcs.remove_piece(us, piece_on(from), from, ifo);
-		pcs.add_piece(to_move(), cp, from, ifo);
-		pcs.add_piece(us, pawn, to, ifo);
+		pcs.remove_piece<false>(us, piece_on(from), from, ifo);
+		pcs.add_piece<false>(to_move(), cp, from, ifo);
+		pcs.add_piece<false>(us, pawn, to, ifo);
 	}
 
 	else if (t == castle_ks) {
 		Square rt = (us == white ? H1 : H8);
 		Square rf = (us == white ? F1 : F8);
-		pcs.do_quiet(us, king, from, to, ifo);
-		pcs.do_quiet(us, rook, rf, rt, ifo);
+		pcs.do_quiet<false>(us, king, from, to, ifo);
+		pcs.do_quiet<false>(us, rook, rf, rt, ifo);
 	}
 
 	else if (t == castle_qs) {
 		Square rf = (us == white ? D1 : D8);
 		Square rt = (us == white ? A1 : A8);
-		pcs.do_quiet(us, king, from, to, ifo);
-		pcs.do_quiet(us, rook, rf, rt, ifo);
+		pcs.do_quiet<false>(us, king, from, to, ifo);
+		pcs.do_quiet<false>(us, rook, rf, rt, ifo);
 	}
 	ifo = history[--hidx];
 }
@@ -347,23 +356,23 @@ void position::do_null_move() {
 
 	// eps square
 	if (ifo.eps != Square::no_square) {
-		ifo.key ^= zobrist::ep(util::col(ifo.eps));
-		ifo.repkey ^= zobrist::ep(util::col(ifo.eps));
+		toggle_ep_keys();
 		ifo.eps = Square::no_square;
 	}
 
 	// side to move
 	ifo.stm = them;
-	ifo.key ^= zobrist::stm(ifo.stm);
-	ifo.repkey ^= zobrist::stm(ifo.stm);
+	toggle_side_keys();
 
 	// move50
 	ifo.move50++;
-	ifo.key ^= zobrist::mv50(ifo.move50);
 
 	// half-moves
 	ifo.hmvs++;
-	ifo.key ^= zobrist::hmvs(ifo.hmvs);
+	ifo.plies_from_null = 0;
+
+	// board is unchanged, only the check squares depend on the side to move
+	ifo.ci.check_sq_valid = false;
 }
 
 
@@ -372,173 +381,131 @@ void position::undo_null_move() {
 }
 
 
-std::vector<int> mvals{ 100, 300, 315, 480, 910, 2000 };
-
-int position::see(const Move& m) const {
-
-	if (m.type == Movetype::ep) return 0;
-
-	else if (m.type == Movetype::capture &&
-		(mvals[piece_on(Square(m.f))] <= mvals[piece_on(Square(m.t))])) {
-		return (mvals[piece_on(Square(m.t))] - mvals[piece_on(Square(m.f))]);
-	}
-
-	else if (m.type == Movetype::capture_promotion_q ||
-		m.type == Movetype::capture_promotion_r ||
-		m.type == Movetype::capture_promotion_b ||
-		m.type == Movetype::capture_promotion_n) {
-		int fval = (m.type == Movetype::capture_promotion_q ? mvals[queen] :
-			m.type == Movetype::capture_promotion_r ? mvals[rook] :
-			m.type == Movetype::capture_promotion_b ? mvals[bishop] :
-			mvals[knight]) - mvals[0];
-		int tval = mvals[piece_on(Square(m.t))];
-
-		if (fval <= tval) return fval - tval;
-	}
-
+constexpr int mvals[pieces] = { 100, 300, 315, 480, 910, 2000 };
 
-	return see_move(m);
+// value of the piece a move captures, including the promotion gain
+inline int captured_value(const position& p, const Move& m) {
+	const Movetype t = Movetype(m.type);
+	const Piece victim = p.piece_on(Square(m.t));
+	int v = (t == Movetype::ep ? mvals[pawn] : victim == no_piece ? 0 : mvals[victim]);
+	if (t <= Movetype::capture_promotion_n) v += mvals[queen - (t & 3)] - mvals[pawn];
+	return v;
 }
 
-struct SeePiece {
-	SeePiece(const Piece& pc, const int16& v) : p(pc), score(v) { }
-	Piece p;
-	int16 score;
-	inline bool operator<(const SeePiece& o) const { return score < o.score; }
-	inline bool operator>(const SeePiece& o) const { return score > o.score; }
-};
-
-int position::see_move(const Move& m) const {
-
-	Square bks = king_square(black);
-	Square wks = king_square(white);
-	Square to = Square(m.t);
-	Square from = Square(m.f);
-	U64 pieces = all_pieces();
-	U64 attackers = 0ULL;
-
-	U64 white_bb = get_pieces<white>() ^ pinned<white>();
-	U64 black_bb = get_pieces<black>() ^ pinned<black>();
+inline Piece moved_piece(const position& p, const Move& m) {
+	const Movetype t = Movetype(m.type);
+	return (t <= Movetype::capture_promotion_n ? Piece(queen - (t & 3)) : p.piece_on(Square(m.f)));
+}
 
-	std::vector<SeePiece> black_list;
-	std::vector<SeePiece> white_list;
-	Piece atkr = Piece::no_piece;
+inline Piece position::see_next_attacker(const Square& to, const Color& c, U64& occ, U64& attackers) const {
+	U64 atks = attackers & occ & pcs.bycolor[c];
 
-	while (true) { // while loop for pieces behind currently attacking pieces
-		U64 a = attackers_of(to, pieces) & pieces;
-		if (a) {
-			pieces ^= a;
+	// pinned pieces stay put while their pinner is on the board
+	if (ifo.ci.pinners[c] & occ)
+		atks &= ~ifo.ci.blockers[c];
 
-			if (is_attacked(wks, white, black, pieces) || is_attacked(bks, black, white, pieces))
-			{
-				return 0; // let search handle discovered checking sequences
-			}
+	if (atks == 0ULL)
+		return no_piece;
 
-			attackers |= a;
-		}
-		else break;
-
-		U64 white_attackers = a & white_bb;
-		if (white_attackers) {
-			while (white_attackers) {
-				Square s = Square(bits::pop_lsb(white_attackers));
-				if (s == from) {
-					atkr = piece_on(Square(s));
-					continue; // first attacker is handled below
-				}
-				white_list.emplace_back(SeePiece(piece_on(s), mvals[piece_on(s)]));
-			}
-		}
+	for (int p = pawn; p <= king; ++p) {
+		U64 bb = atks & pcs.bitmap[c][p];
+		if (bb == 0ULL)
+			continue;
 
-		U64 black_attackers = a & black_bb;
-		if (black_attackers) {
-			while (black_attackers) {
-				Square s = Square(bits::pop_lsb(black_attackers));
-				if (s == from) {
-					atkr = piece_on(s);
-					continue;
-				}
-				black_list.emplace_back(SeePiece(piece_on(s), mvals[piece_on(s)]));
-			}
-		}
+		occ ^= bb & (0ULL - bb);
 
-		if (white_list.size() == 0 && black_list.size() == 0 && atkr == Piece::no_piece) return 0;
+		// x-rays : sliders behind the piece that just left now see the square
+		if (p == pawn || p == bishop || p == queen)
+			attackers |= magics::attacks<bishop>(occ, to) &
+				(pcs.bitmap[white][bishop] | pcs.bitmap[black][bishop] | pcs.bitmap[white][queen] | pcs.bitmap[black][queen]);
+		if (p == rook || p == queen)
+			attackers |= magics::attacks<rook>(occ, to) &
+				(pcs.bitmap[white][rook] | pcs.bitmap[black][rook] | pcs.bitmap[white][queen] | pcs.bitmap[black][queen]);
+		return Piece(p);
 	}
+	return no_piece;
+}
 
-	std::sort(white_list.begin(), white_list.end());
-	std::sort(black_list.begin(), black_list.end());
-
-
-	int i = 0;
-	unsigned w = 0;
-	unsigned b = 0;
-	Color color = to_move();
+int position::see_move(const Move& m) const {
+	const Movetype t = Movetype(m.type);
+	if (t == Movetype::castle_ks || t == Movetype::castle_qs)
+		return 0;
 
+	const Square from = Square(m.f);
+	const Square to = Square(m.t);
+	int gain[32];
+	int d = 0;
+	gain[0] = captured_value(*this, m);
+	Piece next = moved_piece(*this, m);
 
-	if (color == black) { black_list.insert(black_list.begin(), SeePiece(atkr, 0)); }
-	else { white_list.insert(white_list.begin(), SeePiece(atkr, 0)); }
+	U64 occ = all_pieces() ^ bitboards::squares[from];
+	if (t == Movetype::ep) occ ^= bitboards::squares[to + (to_move() == white ? -8 : 8)];
+	U64 attackers = attackers_of(to, occ) & occ;
+	Color c = to_move();
 
-	int score = 0;
-	int prev = score;
+	while (d < 31) {
+		c = Color(c ^ 1);
+		Piece p = see_next_attacker(to, c, occ, attackers);
+		if (p == no_piece)
+			break;
 
-	while (true) {
+		// the king only recaptures on an undefended square
+		if (p == king && (attackers & occ & pcs.bycolor[c ^ 1]))
+			break;
 
-		Piece victim = Piece::no_piece;
-		if (i == 0) {
-			Piece v = piece_on(to);
-			if (v == Piece::king) return 0; // illegal
-			score += (v == Piece::no_piece ? 0 : mvals[v]);
-			color = Color(color ^ 1);
-			prev = score;
-			++i;
-			continue;
-		}
+		++d;
+		gain[d] = mvals[next] - gain[d - 1];
+		next = p;
+	}
 
-		if ((w >= white_list.size() || b >= black_list.size())) break;
+	// either side may stop capturing
+	for (; d > 0; --d)
+		gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
 
-		victim = (color == white ? black_list[b++].p : white_list[w++].p);
+	return gain[0];
+}
 
-		int av = -1;
-		Piece attacker = Piece::no_piece;
-		if (color == white && w < white_list.size()) {
-			attacker = white_list[w].p;
-			av = mvals[attacker];
-		}
-		else if (color == black && b < black_list.size()) {
-			attacker = black_list[b].p;
-			av = mvals[attacker];
-		}
+bool position::see_ge(const Move& m, const int& threshold) const {
+	const Movetype t = Movetype(m.type);
+	if (t == Movetype::castle_ks || t == Movetype::castle_qs)
+		return threshold <= 0;
 
-		if (attacker == Piece::no_piece) break;
+	const Square from = Square(m.f);
+	const Square to = Square(m.t);
 
+	// decided without exchanges : losing even with the capture, or winning even if the piece is lost
+	int swap = captured_value(*this, m) - threshold;
+	if (swap < 0)
+		return false;
 
-		color = Color(color ^ 1);
-		int vv = mvals[victim];
+	swap = mvals[moved_piece(*this, m)] - swap;
+	if (swap <= 0)
+		return true;
 
+	U64 occ = all_pieces() ^ bitboards::squares[from];
+	if (t == Movetype::ep) occ ^= bitboards::squares[to + (to_move() == white ? -8 : 8)];
+	U64 attackers = attackers_of(to, occ) & occ;
+	Color c = to_move();
+	int res = 1;
 
+	// 'swap' is what the side to move must win back to stay above the threshold,
+	// each recapture flips the result until a side runs out of attackers or can stop ahead
+	while (true) {
+		c = Color(c ^ 1);
+		Piece p = see_next_attacker(to, c, occ, attackers);
+		if (p == no_piece)
+			break;
 
-		if (vv < av || victim == king) {
-			if (attacker == king) {
-				if ((color == black && b < black_list.size()) ||
-					(color == white && w < white_list.size())) {
-					return score; // illegal
-				}
-			}
+		res ^= 1;
 
+		if (p == king)
+			return (attackers & occ & pcs.bycolor[c ^ 1]) ? bool(res ^ 1) : bool(res);
 
-			if ((victim == king && ((color == black && w < white_list.size()) || (color == white && b < black_list.size()))) ||
-				(victim != king && ((color == black && (black_list.size() > white_list.size())) ||
-					(color == white && (white_list.size() > black_list.size()))))) {
-				score = prev;
-				return score;
-			}
-		}
-		score += ((i & 1) == 1 ? -vv : vv);
-		++i;
-		prev = score;
+		if ((swap = mvals[p] - swap) < res)
+			break;
 	}
 
-	return score;
+	return bool(res);
 }
 
 inline bool _is_promotion(const Movetype& mt) {
@@ -564,96 +531,78 @@ bool position::is_promotion(const U8& mt)
 
 bool position::gives_check(const Move& m) {
 	// Note: assumes the input move is legal (!)
-	auto mask = 0ULL;
-	auto c = to_move();
-	auto them = Color(c ^ 1);
-	auto isCapture = m.type == Movetype::capture ||
-		m.type == Movetype::capture_promotion ||
-		m.type == Movetype::capture_promotion_b ||
-		m.type == Movetype::capture_promotion_n ||
-		m.type == Movetype::capture_promotion_q ||
-		m.type == Movetype::capture_promotion_r;
-	auto isPromotion = is_promotion(m.type);
-	auto isEp = m.type == Movetype::ep;
-	auto isQuiet = m.type == Movetype::quiet;
-	auto isCastles = m.type == Movetype::castles ||
-		m.type == Movetype::castle_ks ||
-		m.type == Movetype::castle_qs;
-	auto from = m.f;
-	auto to = m.t;
-	auto capSq = Square::no_square;
-	auto promotePiece = Piece::no_piece;
-	auto piece = piece_on(Square(from));
-	auto capPiece = Piece::no_piece;
-	if (piece == king && !isCastles)
-		return false;
-
-	// Move our piece
-	if (isCastles) {
-		if (c == white) {
-			to = (m.type == Movetype::castle_ks ? F1 : D1);
-			from = (m.type == Movetype::castle_ks ? H1 : A1);
-		}
-		else if (c == black) {
-			to = (m.type == Movetype::castle_ks ? F8 : D8);
-			from = (m.type == Movetype::castle_ks ? H8 : A8);
-		}
-		pcs.bitmap[c][rook] ^= (bitboards::squares[from] | bitboards::squares[to]);
-	}
-	else {
-		pcs.bitmap[c][piece] ^= (bitboards::squares[from] | bitboards::squares[to]);
-		if (isPromotion)
-			pcs.bitmap[c][piece] ^= bitboards::squares[to];
-	}
-
-	// Remove the captured piece
-	if (isCapture || isEp) {
-		if (isEp)
-			capSq = Square(to + (c == white ? -8 : 8));
-		else
-			capSq = Square(to);
-
-		capPiece = piece_on(Square(capSq));
-		pcs.bitmap[them][capPiece] ^= bitboards::squares[capSq];
-		mask ^= bitboards::squares[capSq];
-	}
-
-	// Add promotion piece
-	if (isPromotion) {
-		if (m.type == Movetype::capture_promotion_n || m.type == Movetype::promotion_n)
-			promotePiece = knight;
-		if (m.type == Movetype::capture_promotion_b || m.type == Movetype::promotion_b)
-			promotePiece = bishop;
-		if (m.type == Movetype::capture_promotion_r || m.type == Movetype::promotion_r)
-			promotePiece = rook;
-		if (m.type == Movetype::capture_promotion_q || m.type == Movetype::promotion_q)
-			promotePiece = queen;
-		pcs.bitmap[c][promotePiece] |= bitboards::squares[to];
-	}
+	const Color us = to_move();
+	const Color them = Color(us ^ 1);
+	const Square from = Square(m.f);
+	const Square to = Square(m.t);
+	const Square eks = king_square(them);
+	const Movetype mt = Movetype(m.type);
 
-	// Make the check mask
-	mask = (all_pieces() ^ bitboards::squares[from]) | bitboards::squares[to];
+	if (mt == castle_ks || mt == castle_qs) {
+		// rare, play the castle on the occupancy and look at the sliders from the enemy king
+		Square rf = (mt == castle_ks ? (us == white ? H1 : H8) : (us == white ? A1 : A8));
+		Square rt = (mt == castle_ks ? (us == white ? F1 : F8) : (us == white ? D1 : D8));
+		U64 occ = (all_pieces() ^ bitboards::squares[from] ^ bitboards::squares[rf]) |
+			bitboards::squares[to] | bitboards::squares[rt];
+		U64 queens = pcs.bitmap[us][queen];
+		U64 rooks = pcs.bitmap[us][rook] ^ bitboards::squares[rf] ^ bitboards::squares[rt];
+		return
+			((magics::attacks<rook>(occ, eks) & (rooks | queens)) != 0ULL) ||
+			((magics::attacks<bishop>(occ, eks) & (pcs.bitmap[us][bishop] | queens)) != 0ULL);
+	}
+
+	if (!ifo.ci.check_sq_valid)
+		update_check_squares();
+
+	// direct check (promotions are handled below)
+	Piece p = piece_on(from);
+	if (mt == quiet || mt == capture || mt == ep) {
+		if (ifo.ci.check_sq[p] & bitboards::squares[to])
+			return true;
+	}
+
+	// discovered check, the moving piece leaves the line to the enemy king
+	if ((discovered_check_candidates() & bitboards::squares[from]) && !util::aligned(from, to, eks))
+		return true;
 
-	auto target = king_square(them);
-	auto checks = is_attacked(target, them, c, mask);
+	if (mt == quiet || mt == capture)
+		return false;
 
-	// Reset the pcs bitmap
-	if (isCastles) {
-		pcs.bitmap[c][rook] ^= (bitboards::squares[to] | bitboards::squares[from]);
-	}
-	else {
-		// Move our piece back
-		pcs.bitmap[c][piece] ^= (bitboards::squares[to] | bitboards::squares[from]);
-
-		// Place back the captured piece and remove promotion piece
-		if (isCapture || isEp)
-			pcs.bitmap[them][capPiece] |= bitboards::squares[capSq];
-		if (isPromotion) {
-			pcs.bitmap[c][promotePiece] ^= bitboards::squares[to];
-		}
-	}
+	if (mt == ep) {
+		// both pawns leave their squares, check the sliders along the opened lines
+		Square csq = Square(to + (us == white ? -8 : 8));
+		U64 occ = (all_pieces() ^ bitboards::squares[from] ^ bitboards::squares[csq]) | bitboards::squares[to];
+		U64 queens = pcs.bitmap[us][queen];
+		return
+			((magics::attacks<bishop>(occ, eks) & (pcs.bitmap[us][bishop] | queens)) != 0ULL) ||
+			((magics::attacks<rook>(occ, eks) & (pcs.bitmap[us][rook] | queens)) != 0ULL);
+	}
+
+	// promotions, the vacated square can open a line for the new slider
+	Piece promoted = (mt == promotion_q || mt == capture_promotion_q ? queen :
+		mt == promotion_r || mt == capture_promotion_r ? rook :
+		mt == promotion_b || mt == capture_promotion_b ? bishop : knight);
+	U64 occ = all_pieces() ^ bitboards::squares[from];
+	U64 attks = (promoted == knight ? bitboards::nmask[to] :
+		promoted == bishop ? magics::attacks<bishop>(occ, to) :
+		promoted == rook ? magics::attacks<rook>(occ, to) :
+		magics::attacks<bishop>(occ, to) | magics::attacks<rook>(occ, to));
+	return (attks & bitboards::squares[eks]) != 0ULL;
+}
 
-	return checks;
+void position::update_check_squares() {
+	const Color us = to_move();
+	const Color them = Color(us ^ 1);
+	const Square eks = king_square(them);
+	const U64 occ = all_pieces();
+
+	ifo.ci.check_sq[pawn] = bitboards::pattks[them][eks];
+	ifo.ci.check_sq[knight] = bitboards::nmask[eks];
+	ifo.ci.check_sq[bishop] = magics::attacks<bishop>(occ, eks);
+	ifo.ci.check_sq[rook] = magics::attacks<rook>(occ, eks);
+	ifo.ci.check_sq[queen] = ifo.ci.check_sq[bishop] | ifo.ci.check_sq[rook];
+	ifo.ci.check_sq[king] = 0ULL;
+	ifo.ci.check_sq_valid = true;
 }
 
 bool position::quiet_gives_dangerous_check(const Move& m)
@@ -791,7 +740,7 @@ bool position::is_legal(const Move& m) {
 	}
 
 	// pinned
-	if ((bitboards::squares[f] & ifo.pinned[ifo.stm]) && !util::aligned(ks, f, t)) 
+	if ((bitboards::squares[f] & pinned(us)) && !util::aligned(ks, f, t)) 
 		return false;
 
 	// ep can uncover a discovered check
@@ -906,32 +855,36 @@ bool position::is_legal(const Move& m) {
 	return true;
 }
 
-U64 position::pinned(const Color us) {
-	const Color them = Color(us ^ 1);
-	const Square ks = king_square(us);
-	U64 pinned = 0ULL;
+U64 position::slider_blockers(const Color c, U64& pinners) const {
+	const Color them = Color(c ^ 1);
+	const Square ks = king_square(c);
+	const U64 occ = all_pieces();
+	U64 blockers = 0ULL;
+	pinners = 0ULL;
+
 	U64 bs = pcs.bitmap[them][bishop] | pcs.bitmap[them][queen];
 	U64 rs = pcs.bitmap[them][rook] | pcs.bitmap[them][queen];
+	U64 snipers = (bs & bitboards::battks[ks]) | (rs & bitboards::rattks[ks]);
 
-	U64 sliders = (bs & bitboards::battks[ks]) | (rs & bitboards::rattks[ks]);
+	while (snipers) {
+		int sq = bits::pop_lsb(snipers);
 
-	if (sliders == 0ULL) {
-		return pinned;
-	}
-
-	do {
-		int sq = bits::pop_lsb(sliders);
-
-		if (!util::aligned(sq, ks)) continue;
-
-		U64 tmp = (bitboards::between[sq][ks] & all_pieces()) ^
+		U64 tmp = (bitboards::between[sq][ks] & occ) ^
 			(bitboards::squares[ks] | bitboards::squares[sq]);
 
-		if (!bits::more_than_one(tmp)) pinned |= tmp;
+		if (tmp != 0ULL && !bits::more_than_one(tmp)) {
+			blockers |= tmp;
+			if (tmp & pcs.bycolor[c]) pinners |= bitboards::squares[sq];
+		}
+	}
 
-	} while (sliders);
+	return blockers;
+}
 
-	return pinned & pcs.bycolor[us];
+void position::update_check_info() {
+	ifo.ci.blockers[white] = slider_blockers(white, ifo.ci.pinners[white]);
+	ifo.ci.blockers[black] = slider_blockers(black, ifo.ci.pinners[black]);
+	ifo.ci.check_sq_valid = false;
 }
 
 bool position::in_check() const {
@@ -949,7 +902,8 @@ bool position::in_dangerous_check()
 	if (bits::more_than_one(ifo.checkers))
 		return true;
 
-	auto c = bits::pop_lsb(ifo.checkers);
+	U64 checks = ifo.checkers;
+	auto c = bits::pop_lsb(checks);
 	auto piece = piece_on(Square(c));
 	auto row_dist = util::row_dist(c, (int)king_square());
 	auto col_dist = util::col_dist(c, (int)king_square());
@@ -1026,7 +980,6 @@ void position::clear() {
 	qnodes_searched = 0;
 	std::memset(&ifo, 0, sizeof(info));
 	ifo = {};
-	ifo.repkey = 0ULL;
 	ifo.key = 0ULL;
 	ifo.pawnkey = 0ULL;
 }
@@ -1039,10 +992,10 @@ void position::print() const {
 
 		for (Col c = A; c <= H; ++c) {
 			Square s = Square(8 * r + c);
-			if (pcs.piece_on[s] != no_piece) {
-				Piece p = pcs.piece_on[s];
+			if (pcs.piece_on(s) != no_piece) {
+				Piece p = pcs.piece_on(s);
 				std::cout << "| "
-					<< (pcs.color_on[s] == Color::white ? SanPiece[p] : SanPiece[p + 6])
+					<< (pcs.color_on(s) == Color::white ? SanPiece[p] : SanPiece[p + 6])
 					<< " ";
 			}
 			else std::cout << "|   ";
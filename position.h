@@ -27,16 +27,30 @@
 struct Move;
 
 
+/// <summary>
+/// Check related data, blockers/pinners are refreshed once per move for both kings.
+/// The check squares of the side to move are only filled on the first gives_check() call at a node.
+/// </summary>
+struct check_info {
+	U64 blockers[2]; // pieces (either color) shielding the king of color c from an enemy slider
+	U64 pinners[2]; // enemy sliders pinning a piece of color c to its king
+	U64 check_sq[pieces]; // squares from which each piece type of the side to move attacks the enemy king
+	bool check_sq_valid;
+};
+
+
 struct info {
 	U64 checkers;
-	U64 pinned[2];
-	U64 key;
-	U64 mkey;
+	check_info ci;
+	U64 key; // position only : pieces, side to move, castle rights, ep square
 	U64 pawnkey;
-	U64 repkey;
+#ifdef HAVOC_KEY128
+	U64 key2; // independent verification key
+#endif
 	U16 hmvs;
 	U16 cmask;
 	U8 move50;
+	U16 plies_from_null; // repetitions cannot span a null move
 	Color stm;
 	Square eps;
 	Square ks[2];
@@ -45,13 +59,36 @@ struct info {
 	bool incheck;
 };
 
+/// <summary>
+/// Fixed capacity principal variation (no heap storage), root moves copy and re-rank as plain memory
+/// </summary>
+struct pv_line {
+	std::array<Move, Depth::MAX_PLY> moves;
+	U8 length = 0;
+
+	inline size_t size() const { return length; }
+	inline void clear() { length = 0; }
+	inline void push_back(const Move& m) { if (length < Depth::MAX_PLY) moves[length++] = m; }
+	inline const Move& operator[](const size_t& i) const { return moves[i]; }
+	inline const Move* begin() const { return moves.data(); }
+	inline const Move* end() const { return moves.data() + length; }
+
+	// first move followed by a child line from the pv table (terminated by an empty move)
+	inline void load(const Move& first, const Move* child) {
+		length = 0;
+		push_back(first);
+		for (; child && child->f != child->t && child->type != Movetype::no_type; ++child)
+			push_back(*child);
+	}
+};
+
 /// <summary>
 /// Rootmove idea taken from Stockfish
 /// Allows easy mgmt of pv/multi-pv/time mgmt
 /// </summary>
 struct Rootmove {
-	Rootmove(const Move& m) : pv(1, m) {}
-	std::vector<Move> pv;
+	Rootmove(const Move& m) { pv.push_back(m); }
+	pv_line pv;
 	int selDepth = 0;
 	Score score = Score::ninf; // score for pv[0] == root
 	Score prevScore = Score::ninf; // last score for pv[0] == root
@@ -65,16 +102,20 @@ struct Rootmove {
 typedef std::vector<Rootmove> Rootmoves;
 
 
+/// <summary>
+/// Board core : per color/piece bitboards plus an 8-bit mailbox (piece | color << 3).
+/// Piece lists are not kept, callers iterate the bitboards and counts come from popcount.
+/// </summary>
 struct piece_data {
 
+	static constexpr U8 empty_sq = U8(Piece::no_piece | (Color::no_color << 3));
+
 	std::array<U64, 2> bycolor;
 	std::array<Square, 2> king_sq;
-	std::array<Color, squares> color_on;
-	std::array<Piece, squares> piece_on;
-	std::array<std::array<int, pieces>, 2> number_of;
+	std::array<U8, squares> mailbox;
 	std::array<std::array<U64, squares>, colors> bitmap;
-	std::array<std::array<std::array<int, squares>, pieces>, 2> piece_idx;
-	std::array<std::array<std::array<Square, 11>, pieces>, 2> square_of;
+	U32 material_idx; // material signature index (see material.h)
+	U16 material_overflow; // pieces beyond the range covered by the signature index
 
 	piece_data() { };
 	piece_data(const piece_data& pd);
@@ -83,8 +124,18 @@ struct piece_data {
 	// utility methods for moving pieces
 	void clear();
 
+	inline Piece piece_on(const Square& s) const { return Piece(mailbox[s] & 7); }
+	inline Color color_on(const Square& s) const { return Color(mailbox[s] >> 3); }
+	inline int number_of(const Color& c, const Piece& p) const { return bits::count(bitmap[c][p]); }
+
 	void set(const Color& c, const Piece& p, const Square& s, info& ifo);
 
+	// key maintenance, one table lookup per square for each key that depends on the piece
+	static inline void toggle_keys(const Color& c, const Piece& p, const Square& s, info& ifo);
+	static inline void move_keys(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo);
+
+	// keys = false : board only (undo restores the keys from history)
+	template<bool keys = true>
 	inline void do_quiet(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo);
 
 	template<Color c>
@@ -107,8 +158,10 @@ struct piece_data {
 
 	inline void do_castle_qs(const Color& c, const Square& f, const Square& t, info& ifo);
 
+	template<bool keys = true>
 	inline void remove_piece(const Color& c, const Piece& p, const Square& s, info& ifo);
 
+	template<bool keys = true>
 	inline void add_piece(const Color& c, const Piece& p, const Square& s, info& ifo);
 };
 
@@ -150,16 +203,23 @@ public:
 	void undo_move(const Move& m);
 	void do_null_move();
 	void undo_null_move();
+	/// <summary>
+	/// Static exchange evaluation of the move on its target square (swap list over bitboards, x-rays included)
+	/// </summary>
 	int see_move(const Move& m) const;
-	int see(const Move& m) const;
+
+	/// <summary>
+	/// True if the static exchange of the move scores at least 'threshold', stops as soon as the outcome is decided
+	/// </summary>
+	bool see_ge(const Move& m, const int& threshold) const;
 
 	inline void stats_update(const Move& m,
-		const Move& previous,
+		const node* stack,
 		const int16& depth,
 		const Score& score,
 		const std::vector<Move>& quiets,
 		Move* killers) {
-		stats.update(*this, m, previous, depth, score, quiets, killers);
+		stats.update(*this, m, stack, depth, score, quiets, killers);
 	}
 	const haVoc::Movehistory* history_stats() const { return &stats; }
 
@@ -183,7 +243,8 @@ public:
 	bool in_dangerous_check();
 
 	/// <summary>
-	/// Returns true if move checks opposing king
+	/// Returns true if the (legal) move checks the opposing king, evaluated before
+	/// the move is made from the check squares and discovered check candidates
 	/// </summary>
 	bool gives_check(const Move& m);
 
@@ -200,8 +261,26 @@ public:
 	/// <param name="m"></param>
 	/// <returns></returns>
 	bool is_legal(const Move& m);
-	U64 pinned(const Color us);
-	bool is_draw();
+	U64 slider_blockers(const Color c, U64& pinners) const;
+	inline Piece see_next_attacker(const Square& to, const Color& c, U64& occ, U64& attackers) const;
+	void update_check_info();
+	void update_check_squares();
+	bool is_draw() const;
+	bool has_upcoming_repetition(const int& ply) const;
+
+	inline void toggle_ep_keys() {
+		ifo.key ^= zobrist::ep(util::col(ifo.eps));
+#ifdef HAVOC_KEY128
+		ifo.key2 ^= zobrist::ep2(util::col(ifo.eps));
+#endif
+	}
+
+	inline void toggle_side_keys() {
+		ifo.key ^= zobrist::side();
+#ifdef HAVOC_KEY128
+		ifo.key2 ^= zobrist::side2();
+#endif
+	}
 
 	inline bool can_castle_ks() const {
 		return ((ifo.cmask & (ifo.stm == white ? wks : bks))) == (ifo.stm == white ? wks : bks);
@@ -230,7 +309,12 @@ public:
 	inline bool has_castled() const { return ifo.has_castled[c]; }
 
 	template<Color c>
-	inline U64 pinned() const { return ifo.pinned[c]; }
+	inline U64 pinned() const { return ifo.ci.blockers[c] & pcs.bycolor[c]; }
+
+	inline U64 pinned(const Color& c) const { return ifo.ci.blockers[c] & pcs.bycolor[c]; }
+
+	// our pieces whose move can uncover a check on the enemy king
+	inline U64 discovered_check_candidates() const { return ifo.ci.blockers[ifo.stm ^ 1] & pcs.bycolor[ifo.stm]; }
 
 	// returns true if there are pawns on the 7th 
 	// rank for either side (hint to search not to aggressively reduce search depth)
@@ -262,23 +346,29 @@ public:
 
 	// position info access wrappers
 	inline Square eps() const { return ifo.eps; }
+	inline U8 move50() const { return ifo.move50; }
 	inline Color to_move() const { return ifo.stm; }
-	inline U64 key() { return ifo.key; }
-	inline U64 repkey() { return ifo.repkey; }
+	inline U64 key() const { return ifo.key; }
+#ifdef HAVOC_KEY128
+	inline U64 verify_key() const { return ifo.key2; }
+#else
+	inline U64 verify_key() const { return 0ULL; }
+#endif
 	inline U64 pawnkey() const { return ifo.pawnkey; }
-	inline U64 material_key() const { return ifo.mkey; }
+	inline U32 material_index() const { return pcs.material_idx; }
+	inline U16 material_overflow() const { return pcs.material_overflow; }
 	// piece access wrappers
 	inline U64 all_pieces() const { return pcs.bycolor[white] | pcs.bycolor[black]; }
 
-	inline unsigned number_of(const Color& c, const Piece& p) const { return pcs.number_of[c][p]; }
+	inline unsigned number_of(const Color& c, const Piece& p) const { return pcs.number_of(c, p); }
 
-	inline Piece piece_on(const Square& s) const { return pcs.piece_on[s]; }
+	inline Piece piece_on(const Square& s) const { return pcs.piece_on(s); }
 
 	inline Square king_square(const Color& c) const { return ifo.ks[c]; }
 
 	inline Square king_square() const { return ifo.ks[ifo.stm]; }
 
-	inline Color color_on(const Square& s) const { return pcs.color_on[s]; }
+	inline Color color_on(const Square& s) const { return pcs.color_on(s); }
 
 	inline U16 id() { return thread_id; }
 
@@ -303,9 +393,13 @@ public:
 	template<Color c>
 	inline U64 get_pieces() const { return pcs.bycolor[c]; }
 
+	inline U64 get_pieces(const Color& c, const Piece& p) const { return pcs.bitmap[c][p]; }
+
+	// first (lowest) square holding piece p of color c, no_square if there is none
 	template<Color c, Piece p>
-	inline Square* squares_of() const {
-		return const_cast<Square*>(pcs.square_of[c][p].data() + 1);
+	inline Square square_of() const {
+		U64 b = pcs.bitmap[c][p];
+		return b != 0ULL ? Square(bits::lsb(b)) : Square::no_square;
 	}
 
 };
@@ -314,51 +408,50 @@ public:
 inline void piece_data::clear() {
 	std::fill(bycolor.begin(), bycolor.end(), 0);
 	std::fill(king_sq.begin(), king_sq.end(), Square::no_square);
-	std::fill(color_on.begin(), color_on.end(), Color::no_color);
-	std::fill(piece_on.begin(), piece_on.end(), Piece::no_piece);
-
-	for (auto& v : number_of) std::fill(v.begin(), v.end(), 0);
+	std::fill(mailbox.begin(), mailbox.end(), empty_sq);
 	for (auto& v : bitmap) std::fill(v.begin(), v.end(), 0ULL);
-	for (auto& v : piece_idx) { for (auto& w : v) { std::fill(w.begin(), w.end(), 0); } }
-	for (auto& v : square_of) { for (auto& w : v) { std::fill(w.begin(), w.end(), Square::no_square); } }
+	material_idx = 0;
+	material_overflow = 0;
 }
 
+inline void piece_data::toggle_keys(const Color& c, const Piece& p, const Square& s, info& ifo) {
+	const U64 k = zobrist::piece(s, c, p);
+	ifo.key ^= k;
+	if (p == Piece::pawn) ifo.pawnkey ^= k;
+#ifdef HAVOC_KEY128
+	ifo.key2 ^= zobrist::piece2(s, c, p);
+#endif
+}
+
+inline void piece_data::move_keys(const Color& c, const Piece& p, const Square& f, const Square& t, info& ifo) {
+	const U64 k = zobrist::piece(f, c, p) ^ zobrist::piece(t, c, p);
+	ifo.key ^= k;
+	if (p == Piece::pawn) ifo.pawnkey ^= k;
+#ifdef HAVOC_KEY128
+	ifo.key2 ^= zobrist::piece2(f, c, p) ^ zobrist::piece2(t, c, p);
+#endif
+}
+
+template<bool keys>
 inline void piece_data::do_quiet(const Color& c, const Piece& p,
 	const Square& f, const Square& t, info& ifo) {
 
 	// bitmaps
 	U64 fto = bitboards::squares[f] | bitboards::squares[t];
 
-	int idx = piece_idx[c][p][f];
-	piece_idx[c][p][f] = 0;
-	piece_idx[c][p][t] = idx;
-
 	bycolor[c] ^= fto;
 	bitmap[c][p] ^= fto;
 
-	square_of[c][p][idx] = t;
-	color_on[f] = no_color;
-	color_on[t] = c;
-
-	piece_on[t] = p;
-	piece_on[f] = no_piece;
-
-	ifo.key = ifo.key ^ zobrist::piece(f, c, p);
-	ifo.key = ifo.key ^ zobrist::piece(t, c, p);
+	mailbox[t] = mailbox[f];
+	mailbox[f] = empty_sq;
 
-	ifo.repkey = ifo.repkey ^ zobrist::piece(f, c, p);
-	ifo.repkey = ifo.repkey ^ zobrist::piece(t, c, p);
-
-	if (p == Piece::pawn) {
-		ifo.pawnkey = ifo.pawnkey ^ zobrist::piece(f, c, p);
-		ifo.pawnkey = ifo.pawnkey ^ zobrist::piece(t, c, p);
-	}
+	if constexpr (keys) move_keys(c, p, f, t, ifo);
 }
 
 inline void piece_data::do_cap(const Color& c, const Piece& p,
 	const Square& f, const Square& t, info& ifo) {
 	Color them = Color(c ^ 1);
-	Piece cap = piece_on[t];
+	Piece cap = piece_on(t);
 	remove_piece(them, cap, t, ifo);
 	do_quiet(c, p, f, t, ifo);
 }
@@ -379,7 +472,7 @@ inline void piece_data::do_ep(const Color& c, const Square& f, const Square& t,
 inline void piece_data::do_promotion_cap(const Color& c, const Piece& p,
 	const Square& f, const Square& t, info& ifo) {
 	Color them = Color(c ^ 1);
-	Piece cap = piece_on[t];
+	Piece cap = piece_on(t);
 	remove_piece(them, cap, t, ifo);
 	remove_piece(c, Piece::pawn, f, ifo);
 	add_piece(c, p, t, ifo);
@@ -401,59 +494,40 @@ inline void piece_data::do_castle_qs(const Color& c, const Square& f, const Squa
 	do_quiet(c, rook, rf, rt, ifo);
 }
 
+template<bool keys>
 inline void piece_data::remove_piece(const Color& c, const Piece& p, const Square& s, info& ifo) {
 	U64 sq = bitboards::squares[s];
 	bycolor[c] ^= sq;
 	bitmap[c][p] ^= sq;
 
-	// carefully remove this piece so when we add it back in undo, we
-	// do not overwrite an existing piece index
-	int tmp_idx = piece_idx[c][p][s];
-	int max_idx = number_of[c][p];
-	Square tmp_sq = square_of[c][p][max_idx];
-	square_of[c][p][tmp_idx] = square_of[c][p][max_idx];
-	square_of[c][p][max_idx] = no_square;
-	piece_idx[c][p][tmp_sq] = tmp_idx;
-	number_of[c][p] -= 1;
-	piece_idx[c][p][s] = 0;
-	color_on[s] = no_color;
-	piece_on[s] = no_piece;
-	ifo.key ^= zobrist::piece(s, c, p);
-	ifo.mkey ^= zobrist::piece(s, c, p);
-	ifo.repkey ^= zobrist::piece(s, c, p);
-	if (p == Piece::pawn) ifo.pawnkey ^= zobrist::piece(s, c, p);
+	// bitmap is already updated : count before removal > max <=> count after >= max
+	material_overflow -= (number_of(c, p) >= material::max_count[p]);
+	material_idx -= material::piece_weight[c][p];
+	mailbox[s] = empty_sq;
+	if constexpr (keys) toggle_keys(c, p, s, ifo);
 }
 
+template<bool keys>
 inline void piece_data::add_piece(const Color& c, const Piece& p, const Square& s, info& ifo) {
 	U64 sq = bitboards::squares[s];
 	bycolor[c] |= sq;
 	bitmap[c][p] |= sq;
 
-	number_of[c][p] += 1;
-	square_of[c][p][number_of[c][p]] = s;
-	piece_on[s] = p;
-	piece_idx[c][p][s] = number_of[c][p];
-	color_on[s] = c;
-	ifo.key ^= zobrist::piece(s, c, p);
-	ifo.mkey ^= zobrist::piece(s, c, p);
-	ifo.repkey ^= zobrist::piece(s, c, p);
-	if (p == Piece::pawn) ifo.pawnkey ^= zobrist::piece(s, c, p);
+	material_idx += material::piece_weight[c][p];
+	material_overflow += (number_of(c, p) > material::max_count[p]);
+	mailbox[s] = U8(p | (c << 3));
+	if constexpr (keys) toggle_keys(c, p, s, ifo);
 }
 
 inline void piece_data::set(const Color& c, const Piece& p, const Square& s, info& ifo) {
 	bitmap[c][p] |= bitboards::squares[s];
 	bycolor[c] |= bitboards::squares[s];
-	color_on[s] = c;
-	number_of[c][p] += 1;
-	piece_idx[c][p][s] = number_of[c][p];
-	square_of[c][p][number_of[c][p]] = s;
-	piece_on[s] = p;
+	material_idx += material::piece_weight[c][p];
+	material_overflow += (number_of(c, p) > material::max_count[p]);
+	mailbox[s] = U8(p | (c << 3));
 	if (p == Piece::king) king_sq[c] = s;
 
-	ifo.key ^= zobrist::piece(s, c, p);
-	ifo.mkey ^= zobrist::piece(s, c, p);
-	ifo.repkey ^= zobrist::piece(s, c, p);
-	if (p == Piece::pawn) ifo.pawnkey ^= zobrist::piece(s, c, p);
+	toggle_keys(c, p, s, ifo);
 }
 
 #endif
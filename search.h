@@ -12,13 +12,31 @@
 
 namespace Search {
 
+	/// <summary>
+	/// Time budget of a single move (ms). The optimum is the target of a normal move, the main thread
+	/// scales it by the stability of the best move and the score trend between iterations and does not
+	/// start an iteration it can't finish. The maximum is the hard limit enforced by the timer thread.
+	/// Both are -1 without a clock (infinite, ponder, depth or node limited searches).
+	/// </summary>
+	struct time_manager {
+		double optimum = -1;
+		double maximum = -1;
+		bool dynamic = false; // clock game (not a fixed movetime) : the optimum is adjusted between iterations
+
+		void init(const position& p, const limits& lims);
+		double scaled_optimum(const double& best_move_changes, const int& score_drop) const;
+		inline bool enabled() const { return maximum > -1; }
+	};
+
+	time_manager timeman;
+	int tb_men = 0; // men covered by the syzygy tables in this search (0 : no probes)
+	const int tb_depth_bonus = 12; // tablebase results are stored 6 plies (half ply units) deeper than the probing node
 	std::atomic_bool searching;
 	std::mutex mtx;
 	void search_timer(position& p, limits& lims);
 	void start(position& p, limits& lims, bool silent);
 	void iterative_deepening(position& p, U16 depth, bool silent);
 	void readout_pv(node* stack, const Rootmoves& mRoots, const Score& eval, const Score& alpha, const Score& beta, const U16& depth);
-	double estimate_max_time(position& p, limits& lims);
 	void update_pv(Move* root, const Move& move, Move* child);
 
 	template<Nodetype type>
@@ -12,6 +12,8 @@
 #include "order.h"
 #include "material.h"
 #include "options.h"
+#include "bitbase.h"
+#include "syzygy.h"
 
 
 std::ofstream debug_file;
@@ -81,11 +83,14 @@ std::vector<std::unique_ptr<position>> mPositions;
 int selDepth = 0;
 size_t hashHits = 0;
 std::mutex search_mtx;
+uci::info_buffer info_out; // reused for every info line (guarded by search_mtx)
 const std::vector<float> material_vals{ 100.0f, 300.0f, 315.0f, 480.0f, 910.0f };
 
 void Search::start(position& p, limits& lims, bool silent) {
 
 	mPositions.clear();
+	ttable.init();
+	ttable.new_search();
 
 	Threadpool<Workerthread> timer_thread(1);
 
@@ -105,14 +110,23 @@ void Search::start(position& p, limits& lims, bool silent) {
 		p.root_moves.push_back(Rootmove(mvs[i]));
 	}
 
+	// tablebase root : only the moves that hold the result are searched, after a dtz ranking the
+	// search itself doesn't probe (every move left keeps the win, the draw or the longest defence)
+	tb_men = syzygy::max_pieces();
+	bool dtz_ranked = false;
+	if (syzygy::covers(p) && syzygy::filter_root_moves(p, p.root_moves, dtz_ranked) && dtz_ranked)
+		tb_men = 0;
+
 	for (unsigned i = 0; i < SearchThreads.size(); ++i) {
 		mPositions.emplace_back(std::make_unique<position>(p));
 		mPositions[i]->set_id(i);
+		SearchThreads[i]->tbHits = 0;
 	}
 
 	U16 depth = (lims.depth > 0 ? lims.depth : 64); // maxdepth
 	searching = true;
 
+	timeman.init(p, lims);
 	timer_thread.enqueue(search_timer, p, lims);
 
 
@@ -150,6 +164,12 @@ void Search::start(position& p, limits& lims, bool silent) {
 	if (bestRoots.size() <= 0)
 		bestRoots = mPositions[0]->root_moves;
 
+	// report totals back to the caller (used by bench/tuning)
+	p.set_nodes_searched(nodes);
+	p.set_qnodes_searched(qnodes);
+	p.elapsed_ms = elapsed;
+	p.bestmove = (bestRoots.size() > 0 ? uci::move_to_string(bestRoots[0].pv[0]) : "");
+
 	if (!silent) {
 		std::cout << "bestmove " << uci::move_to_string(bestRoots[0].pv[0]);
 		if (bestRoots[0].pv.size() > 1)
@@ -167,23 +187,15 @@ void Search::start(position& p, limits& lims, bool silent) {
 void Search::search_timer(position& p, limits& lims) {
 	util::clock c;
 	c.start();
-	bool fixed_time = lims.movetime > 0;
 	int delay = 1; // ms
-	double time_limit = estimate_max_time(p, lims);
 	auto sleep = [delay]() { std::this_thread::sleep_for(std::chrono::milliseconds(delay)); };
 
-	if (fixed_time) {
+	if (timeman.enabled()) {
+		// clock based search : the main thread stops at the (scaled) optimum, this is the hard limit
 		do {
 			elapsed += c.elapsed_ms();
 			sleep();
-		} while (!UCI_SIGNALS.stop && searching && elapsed <= lims.movetime);
-	}
-	else if (time_limit > -1) {
-		// dynamic time estimate in a real game
-		do {
-			elapsed += c.elapsed_ms();
-			sleep();
-		} while (!UCI_SIGNALS.stop && searching && elapsed <= time_limit);
+		} while (!UCI_SIGNALS.stop && searching && elapsed <= timeman.maximum);
 	}
 	else {
 		do {
@@ -196,34 +208,63 @@ void Search::search_timer(position& p, limits& lims) {
 	return;
 }
 
-double Search::estimate_max_time(position& p, limits& lims) {
-	double time_per_move_ms = 0;
-	if (lims.infinite || lims.ponder || lims.depth > 0) return -1;
-	else {
-		bool sudden_death = lims.movestogo == 0; // no moves until next time control
-		bool exact_time = lims.movetime != 0; // searching for an exact number of ms?
-		double remainder_ms = (p.to_move() == white ? lims.wtime + lims.winc : lims.btime + lims.binc);
-		//material_entry * me = mtable.fetch(p);
-		//bool endgame = me->endgame;
-		double moves_to_go = 45.0 - 22.5; // (!endgame ? 22.5 : 30.0);
-
-		if (sudden_death && !exact_time) {
-			time_per_move_ms = 1.5 * remainder_ms / moves_to_go;
-		}
-		else if (exact_time) return (double)lims.movetime;
-		else if (!sudden_death) {
-			time_per_move_ms = remainder_ms / lims.movestogo;
-		}
+void Search::time_manager::init(const position& p, const limits& lims) {
+	optimum = maximum = -1;
+	dynamic = false;
+	if (lims.infinite || lims.ponder || lims.depth > 0) return;
+
+	const double overhead = std::max(opts->value<int>("moveoverhead"), 0); // ms lost per move to the gui/network
+
+	if (lims.movetime > 0) {
+		optimum = maximum = std::max(double(lims.movetime) - overhead, 1.0);
+		return;
 	}
-	return time_per_move_ms;
+
+	const double remainder_ms = (p.to_move() == white ? lims.wtime : lims.btime);
+	const double inc_ms = (p.to_move() == white ? lims.winc : lims.binc);
+	if (remainder_ms <= 0) return; // no clock given
+
+	// expected number of moves left in the game : fewer as the pieces come off the board
+	material_entry scratch;
+	const material_entry* me = material::fetch(p, scratch);
+	const double horizon = 20.0 + me->phase; // 44 at the start .. 20 in pawn endings
+	const double mtg = (lims.movestogo > 0 ? std::min(double(lims.movestogo), horizon) : horizon);
+
+	const double available = std::max(remainder_ms + inc_ms * (mtg - 1) - overhead * mtg, 1.0);
+	optimum = available / mtg;
+	dynamic = true;
+
+	// allow stretching an unstable move to several times the optimum, but keep a reserve on the clock
+	// (with few moves left to the time control there is less room to borrow from the next moves)
+	const double stretch = (lims.movestogo > 0 && lims.movestogo < 5 ? 2.0 : 5.0);
+	maximum = std::min(stretch * optimum, 0.8 * remainder_ms - overhead);
+	maximum = std::max(maximum, 1.0);
+	optimum = std::min(optimum, maximum);
+}
+
+double Search::time_manager::scaled_optimum(const double& best_move_changes, const int& score_drop) const {
+	// 1. best move stability : 0.75 when it hasn't changed for a few iterations, up to 2.0 when it keeps changing
+	double stability = std::min(0.75 + 0.5 * best_move_changes, 2.0);
+
+	// 2. score trend : a falling score gets up to 50% more time to look for a better move
+	double trend = 1.0 + std::clamp(score_drop, 0, 100) / 200.0;
+
+	return std::min(optimum * stability * trend, maximum);
 }
 
 void Search::iterative_deepening(position& p, U16 depth, bool silent) {
 	int16 alpha = ninf;
 	int16 beta = inf;
-	int16 delta = 65;
-	int16 smallDelta = 33;
+	const int smallDelta = 20; // half width of the first window
 	Score eval = ninf;
+	Score prevEval = ninf;
+	Searchthread& thread = *SearchThreads[p.id()];
+
+	// time management (main thread) : best move changes are decayed so recent changes count most
+	Move lastBest = {}; lastBest.type = Movetype::no_type;
+	Score lastScore = ninf;
+	double bestMoveChanges = 0;
+	double iterationStart = 0;
 
 
 	if (p.params.fixed_depth > 0) {
@@ -232,9 +273,11 @@ void Search::iterative_deepening(position& p, U16 depth, bool silent) {
 
 	const unsigned stack_size = 64 + 4;
 	node stack[stack_size];
-	Move pv[Depth::MAX_PLY + 4];
+	Move pv_table[stack_size][Depth::MAX_PLY + 4];
+	for (unsigned i = 0; i < stack_size; ++i)
+		stack[i].pv_row = pv_table[i];
 
-	(stack + 2)->pv = pv;
+	(stack + 2)->pv = (stack + 2)->pv_row;
 
 
 	// Main iterative deepening loop
@@ -245,47 +288,58 @@ void Search::iterative_deepening(position& p, U16 depth, bool silent) {
 
 		(stack+0)->ply = (stack + 1)->ply = (stack + 2)->ply = 0;
 
-		auto failLow = false;
-		auto failHigh = false;
 		hashHits = 0;
 
-		// 1. aspiration window search
-		while (true) {
-			if (id >= 2) {
-				alpha = std::max(int16(eval - smallDelta), int16(ninf));
-				beta = std::min(int16(eval + smallDelta), int16(inf));
-				if (failLow) {
-					beta = std::min(int16(beta + delta), int16(inf));
-					failLow = false;
-				}
-				if (failHigh) {
-					alpha = std::max(int16(alpha - delta), int16(ninf));
-					failHigh = false;
-				}
-			}
+		// 1. aspiration window search : the window is centered on the last score and widened by the score change
+		// between the last iterations (unstable scores get a wider window)
+		int delta = smallDelta;
+		if (id >= 4 && std::abs(eval) < Score::mate_max_ply) {
+			if (prevEval != Score::ninf)
+				delta += std::abs(eval - prevEval) / 2;
+			alpha = int16(std::max(eval - delta, int(ninf)));
+			beta = int16(std::min(eval + delta, int(inf)));
+		}
+		else {
+			alpha = ninf;
+			beta = inf;
+		}
+		prevEval = eval;
+		iterationStart = elapsed;
+		for (Rootmove& rm : p.root_moves)
+			rm.prevScore = (rm.score != Score::ninf ? rm.score : rm.prevScore);
 
-			selDepth = 0;
-			eval = search<root>(p, alpha, beta, id, stack + 2);
+		int failHighs = 0;
+		++thread.aspirationIterations;
 
-			// bring the best move to the front of the root move array
-			std::stable_sort(p.root_moves.begin(), p.root_moves.end());
+		while (true) {
+			// after a fail high the move is most likely good, the re-searches confirm it at a lower depth
+			// (not in the last iteration of a depth limited search, its result must have the requested depth)
+			U16 searchDepth = U16(id < depth ? std::max(1, int(id) - failHighs) : id);
 
+			selDepth = 0;
+			eval = search<root>(p, alpha, beta, searchDepth, stack + 2);
 
 			if (UCI_SIGNALS.stop)
 				break;
 
-			if ((eval <= alpha || eval >= beta))
+			if (main_thread(p) && !silent && (eval <= alpha || eval >= beta))
 				readout_pv(stack, p.root_moves, eval, Score(alpha), Score(beta), id);
 
+			// widen in the failing direction only, from the (fail soft) score returned
 			if (eval <= alpha) {
-				delta += delta / 4;
-				failHigh = true;
+				++thread.aspirationFailLows;
+				beta = int16((alpha + beta) / 2);
+				alpha = int16(std::abs(eval) >= Score::mate_max_ply ? int(ninf) : std::max(eval - delta, int(ninf)));
+				failHighs = 0;
 			}
 			else if (eval >= beta) {
-				delta += delta / 4;
-				failLow = true;
+				++thread.aspirationFailHighs;
+				beta = int16(std::abs(eval) >= Score::mate_max_ply ? int(inf) : std::min(eval + delta, int(inf)));
+				++failHighs;
 			}
 			else break;
+
+			delta += delta / 2;
 		}
 
 
@@ -299,6 +353,25 @@ void Search::iterative_deepening(position& p, U16 depth, bool silent) {
 				UCI_SIGNALS.stop = true;
 				break;
 			}
+
+			if (timeman.dynamic && p.root_moves.size() > 0) {
+				const Move& best = p.root_moves[0].pv[0];
+				bestMoveChanges *= 0.5;
+				if (lastBest.type != Movetype::no_type && best != lastBest)
+					bestMoveChanges += 1.0;
+				int scoreDrop = (lastScore != Score::ninf ? int(lastScore) - int(eval) : 0);
+				lastBest = best;
+				lastScore = eval;
+
+				// the next iteration takes about twice as long as this one, don't start it if it would
+				// end past the optimum (a single legal move needs no search at all)
+				double optimum = timeman.scaled_optimum(bestMoveChanges, scoreDrop);
+				double nextIteration = 2.0 * (elapsed - iterationStart);
+				if (p.root_moves.size() == 1 || elapsed + nextIteration > optimum) {
+					UCI_SIGNALS.stop = true;
+					break;
+				}
+			}
 		}
 	}
 }
@@ -318,24 +391,45 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 	size_t deferred = 0;
 
 	Move ttm = {}; ttm.type = Movetype::no_type; // refactor me
-	Move pv[Depth::MAX_PLY + 4];
 	Score ttvalue = Score::ninf;
 
 	bool in_check = pos.in_check();
 	std::vector<Move> quiets;
 	stack->in_check = in_check;
 	stack->ply = (stack - 1)->ply + 1;
+	(stack + 1)->gen_checks = true; // a qsearch called from here is the first qsearch ply
 
 
 	U16 root_dist = stack->ply;
 	const bool root_node = (type == Nodetype::root && stack->ply == 1);
 	const bool pvNode = (root_node || type == Nodetype::pv);
+	const bool excluded = stack->excluded_move.type != Movetype::no_type; // singular extension search
+
+	// the node stack ends at max ply, extensions must not run past it
+	if (root_dist >= Depth::MAX_PLY)
+		return in_check ? Score::draw : Score(std::lround(eval::evaluate(pos, *SearchThreads[pos.id()], -1)));
 	if (pvNode && selDepth < stack->ply + 1 && main_thread(pos))
 		selDepth++;
 
 	if (!root_node && !in_check && pos.is_draw())
 			return Score::draw;
 
+	// exact endgame knowledge : a drawn king and pawn vs king ending needs no search
+	// (won ones are left to the search, the evaluation scores them as known wins)
+	if (!root_node && bits::count(pos.all_pieces()) == 3 &&
+		(pos.get_pieces<white, pawn>() | pos.get_pieces<black, pawn>()) != 0ULL) {
+		++SearchThreads[pos.id()]->tbHits;
+		if (bitbase::probe(pos) == 0)
+			return Score::draw;
+	}
+
+	// a move back to an earlier position of the tree is available, the score is at least a draw
+	if (!root_node && alpha < Score::draw && pos.has_upcoming_repetition(root_dist - 1)) {
+		alpha = Score::draw;
+		if (alpha >= beta)
+			return Score::draw;
+	}
+
 	{ // mate distance pruning
 		Score mating_score = Score(Score::mate - root_dist);
 		beta = std::min(mating_score, Score(beta));
@@ -348,45 +442,76 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 			return mated_score;
 	}
 
-	// hashtable lookup
+	// hashtable lookup (the entry of this position belongs to the search that includes the excluded move)
 	auto hashHit = false;
-	{
-		hash_data e;
-		hashHit = ttable.fetch(pos.key(), e);
+	hash_data e;
+	if (!excluded) {
+		hashHit = ttable.fetch(pos.key(), e, pos.verify_key());
 		if (hashHit) {
 			ttm = e.move;
 			hashHits++;
-			ttvalue = Score(e.score);
+			if (e.bound != no_bound)
+				ttvalue = Score(e.score);
 			if (!pvNode &&
 				e.depth >= depth &&
-				(ttvalue >= beta ? e.bound == bound_low : e.bound == bound_high)) {
-				pos.stats_update(ttm, (stack - 1)->curr_move, depth, ttvalue, quiets, stack->killers);
+				(e.bound == bound_exact || (ttvalue >= beta ? e.bound == bound_low : e.bound == bound_high))) {
+				pos.stats_update(ttm, stack, depth, ttvalue, quiets, stack->killers);
 				return ttvalue;
 			}
 		}
 	}
 
+	// syzygy tables : the stored result is exact right after a capture or pawn move (50 move counter at 0),
+	// draws and bounds outside the window end the node. The result goes to the tt with a raised depth
+	// so later visits are cut there instead of probing again.
+	if (!root_node && !excluded && tb_men > 0 && pos.move50() == 0 &&
+		bits::count(pos.all_pieces()) <= tb_men && syzygy::covers(pos)) {
+		bool ok = false;
+		const int wdl = syzygy::probe_wdl(pos, ok);
+		if (ok) {
+			++SearchThreads[pos.id()]->tbHits;
+			const bool drawn = (wdl >= -1 && wdl <= 1);
+			const Score value = (drawn ? Score::draw : wdl > 0 ? Score(Score::tb_win - root_dist) : Score(-Score::tb_win + root_dist));
+			const Bound bound = (drawn ? bound_exact : wdl > 0 ? bound_low : bound_high);
+			if (drawn || (wdl > 0 ? value >= beta : value <= alpha)) {
+				ttable.save(pos.key(), U8(std::min(int(depth) + tb_depth_bonus, 255)), U8(bound), Move(), value, Score::ninf, pos.verify_key());
+				return value;
+			}
+		}
+	}
+
 	// static evaluation
 	const bool anyPawnsOn7th = pos.pawns_near_promotion(); // either side has pawns on 7th
 	const bool weHavePawnsOn7th = pos.pawns_on_7th(); // only side to move has pawns on 7th
 
-	Score static_eval = (ttvalue != Score::ninf ? ttvalue :
-		(stack-2)->static_eval != ninf && !in_check && (stack-2)->static_eval >= (stack-1)->static_eval ? Score((stack-2)->static_eval + 15) :
-		!in_check ? 
-		Score(std::lround(eval::evaluate(pos, *SearchThreads[pos.id()], lazy_eval_margin_search(depth, anyPawnsOn7th)))) :
-		Score::ninf);
-	 
-	//Score static_eval = Score::ninf;
-	//if (ttvalue == Score::ninf &&
-	//	!pvNode && 
-	//	!in_check && 
-	//	(stack - 2)->static_eval != Score::ninf &&
-	//	(stack - 1)->best_move.type == Movetype::quiet)
-	//	static_eval = Score((stack - 2)->static_eval + 33);
-	//else if (!in_check)
-	//	static_eval = Score(std::lround(eval::evaluate(pos, *SearchThreads[pos.id()], lazy_eval_margin_search(depth, anyPawnsOn7th))));
+	// static evaluation : the tt entry carries the eval of the position (its score is a search bound, not an eval)
+	Searchthread& thread = *SearchThreads[pos.id()];
+	Score static_eval = Score::ninf;
+	Score tt_eval = Score::ninf; // stored with the entry, lazy (margin dependent) evals are not kept
+	if (excluded)
+		static_eval = stack->static_eval; // same position, evaluated by the enclosing search
+	else if (!in_check) {
+		if (hashHit && e.eval != Score::ninf) {
+			static_eval = tt_eval = Score(e.eval);
+			++thread.ttEvals;
+		}
+		else {
+			bool lazy = false;
+			static_eval = Score(std::lround(eval::evaluate(pos, thread, lazy_eval_margin_search(depth, anyPawnsOn7th), &lazy)));
+			++thread.fullEvals;
+			if (!lazy) {
+				tt_eval = static_eval;
+
+				// eval-only entry (no bound), nodes pruned before the search completes keep their eval
+				if (!hashHit)
+					ttable.save(pos.key(), 0, U8(no_bound), Move(), Score::ninf, tt_eval, pos.verify_key());
+			}
+		}
+	}
+
 	stack->static_eval = static_eval;
 	bool hasStaticValue = static_eval != Score::ninf;
+	bool improving = stack->static_eval - (stack - 2)->static_eval >= 0;
 
 
 	// 0. Define the forward pruning conditions
@@ -398,19 +523,23 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		abs(alpha - beta) == 1 && // only prune in null windows (same condition as !pv_node)
 		hasStaticValue);
 
-	// 1. Futility pruning
-	//if (forward_prune &&
-	//	!weHavePawnsOn7th &&
-	//	depth <= 1 &&
-	//	static_eval > mated_max_ply &&
-	//	static_eval + 1150 < alpha)
-	//	return Score(static_eval);
+	// 1. Reverse futility pruning : the static eval beats beta by a depth dependent margin
+	if (!pvNode &&
+		!in_check &&
+		!excluded &&
+		hasStaticValue &&
+		!weHavePawnsOn7th &&
+		depth <= pos.params.rfp_depth &&
+		static_eval < Score::mate_max_ply &&
+		int(static_eval) - pos.params.rfp_margin * (depth - improving) >= beta)
+		return Score(static_eval);
 
 	// 2. Null move pruning
 	bool null_move_allowed = (pos.to_move() == white ?
 		pos.non_pawn_material<white>() :
 		pos.non_pawn_material<black>());
 	if (forward_prune &&
+		!excluded &&
 		null_move_allowed &&
 		depth >= 6 &&
 		static_eval - 8 * (64 - depth) >= beta) {
@@ -418,7 +547,10 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		int16 R = (depth >= 6 ? depth / 2 : 2);
 		int16 ndepth = depth - R;
 
+		stack->curr_move = Move();
+		stack->moved = Piece::no_piece;
 		(stack + 1)->null_search = true;
+		(stack + 1)->cut_node = !stack->cut_node;
 		pos.do_null_move();
 		Score null_eval = Score(ndepth <= 1 ?
 			-qsearch<non_pv>(pos, -beta, -beta + 1, 0, stack + 1) :
@@ -441,15 +573,78 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		}
 	}
 
-	// Main search
-	U16 moves_searched = 0;
-	haVoc::Moveorder mvs(pos, ttm, stack);
 	Move move;
 	Move pre_move = (stack - 1)->curr_move;
 	Move pre_pre_move = (stack - 2)->curr_move;
-	bool improving = stack->static_eval - (stack - 2)->static_eval >= 0;
+
+	// 3. ProbCut : a good capture beating a raised beta in a shallow search will almost surely beat beta at full depth
+	Score probcut_beta = Score(std::min(beta + int(pos.params.probcut_margin), int(Score::mate_max_ply)));
+	if (!pvNode &&
+		!in_check &&
+		!excluded &&
+		hasStaticValue &&
+		depth >= pos.params.probcut_depth &&
+		std::abs(beta) < Score::mate_max_ply &&
+		!(ttvalue != Score::ninf && e.depth >= depth - 3 && ttvalue < probcut_beta)) {
+
+		++thread.probcutTries;
+		int16 pcdepth = depth - 4;
+		haVoc::QMoveorder pcmvs(pos, ttm, stack);
+
+		while (pcmvs.next_move(pos, move, pre_move, pre_pre_move, stack->threat_move, true)) {
+
+			if (move.type == Movetype::no_type ||
+				move.type == Movetype::quiet ||
+				!pos.is_legal(move) ||
+				!pos.see_ge(move, probcut_beta - static_eval))
+				continue;
+
+			stack->moved = pos.piece_on(Square(move.f));
+			pos.do_move(move);
+			stack->curr_move = move;
+			(stack + 1)->cut_node = !stack->cut_node;
+
+			// qsearch first, a search at depth - 4 (half plies, like depth) only verifies captures which hold there
+			Score value = Score(-qsearch<non_pv>(pos, -probcut_beta, -probcut_beta + 1, 0, stack + 1));
+			if (value >= probcut_beta)
+				value = Score(-search<non_pv>(pos, -probcut_beta, -probcut_beta + 1, pcdepth, stack + 1));
+
+			pos.undo_move(move);
+
+			if (UCI_SIGNALS.stop)
+				return Score::draw;
+
+			if (value >= probcut_beta) {
+				++thread.probcutCuts;
+				ttable.save(pos.key(), std::max(pcdepth, int16(1)), U8(bound_low), move, value, tt_eval, pos.verify_key());
+				return value;
+			}
+		}
+	}
+
+	// 4. Internal iterative deepening / reduction : without a hash move pv nodes run a shallower search
+	// to get one, expected cut nodes are searched a ply shallower instead
+	if (ttm.type == Movetype::no_type && !excluded && !in_check) {
+		if (pvNode &&
+			!root_node &&
+			depth >= pos.params.iid_depth) {
+			search<type>(pos, alpha, beta, depth - U16(pos.params.iid_reduction), stack);
+			if (stack->pv)
+				stack->pv[0].set(A1, A1, Movetype::no_type);
+
+			if (ttable.fetch(pos.key(), e, pos.verify_key()))
+				ttm = e.move;
+		}
+		else if (!pvNode &&
+			stack->cut_node &&
+			depth >= pos.params.iir_depth)
+			depth -= 2;
+	}
+
+	// Main search
+	U16 moves_searched = 0;
+	haVoc::Moveorder mvs(pos, ttm, stack);
 	auto to_mv = pos.to_move();
-	int SEE = 0;
 	auto skipQuiets = false;
 	auto rootMoves = root_node && pos.root_moves[0].pv.size() > 4;
 
@@ -460,7 +655,11 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		if (UCI_SIGNALS.stop)
 			return Score::draw;
 
-		if (move.type == Movetype::no_type || !pos.is_legal(move))
+		if (move.type == Movetype::no_type || move == stack->excluded_move || !pos.is_legal(move))
+			continue;
+
+		// the tablebase filter can leave fewer root moves than the legal ones
+		if (root_node && std::find(pos.root_moves.begin(), pos.root_moves.end(), move) == pos.root_moves.end())
 			continue;
 
 
@@ -488,7 +687,8 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		auto quietFollowup = (stack - 1)->curr_move.type == Movetype::quiet && isQuiet;
 		auto captureFollowup = (stack - 1)->curr_move.type == Movetype::capture && isCapture;
 		auto threatResponse = (stack->threat_move.type != Movetype::no_type && stack->threat_move.f == move.t) && isCapture;
-		auto dangerousQuietCheck = isQuiet && pos.quiet_gives_dangerous_check(move);
+		auto givesCheck = pos.gives_check(move);
+		auto dangerousQuietCheck = isQuiet && givesCheck && pos.quiet_gives_dangerous_check(move);
 
 		// 4. Skip moves with negative see scores
 		if (isCapture &&
@@ -499,7 +699,7 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 			bestScore < alpha &&
 			depth <= 1 &&
 			moves_searched > 1 &&
-			(SEE = pos.see(move)) < 0)
+			!pos.see_ge(move, 0))
 			continue;
 
 		// Debug viz readout
@@ -513,14 +713,52 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		//		util::col(move.t) << "|" << util::row(move.t) << std::endl;
 		//}
 		
+		// quiet history of the move (butterfly + continuation), read before the move is made
+		int history = isQuiet ?
+			pos.history_stats()->score(move, to_mv) + pos.history_stats()->continuation_score(pos, stack, move) : 0;
+
+		// 5. History pruning : late quiets that keep failing low are skipped near the leaves
+		if (isQuiet &&
+			!pvNode &&
+			!isEvasion &&
+			!hashOrKiller &&
+			!givesCheck &&
+			!advancedPawnPush &&
+			bestScore > Score::mated_max_ply &&
+			depth <= pos.params.history_prune_depth &&
+			history < -pos.params.history_prune_margin * depth)
+			continue;
+
+		// 6. Singular extension : the tt move is extended when all alternatives fail well below its score,
+		// when they beat beta as well several moves cut and the node is pruned (multi-cut)
+		int16 singular = 0;
+		if (!root_node &&
+			!excluded &&
+			move == ttm &&
+			depth >= pos.params.singular_depth &&
+			e.depth >= depth - 3 &&
+			(e.bound == bound_low || e.bound == bound_exact) &&
+			std::abs(ttvalue) < Score::mate_max_ply) {
+
+			Score singular_beta = Score(std::max(ttvalue - int(pos.params.singular_margin * depth), int(Score::mated_max_ply)));
+			stack->excluded_move = move;
+			Score value = search<non_pv>(pos, singular_beta - 1, singular_beta, (depth - 1) / 2, stack);
+			stack->excluded_move = Move();
+
+			if (value < singular_beta)
+				singular = 2; // a full ply, depth counts half plies
+			else if (singular_beta >= beta)
+				return singular_beta;
+		}
+
+		stack->moved = pos.piece_on(Square(move.f));
 		pos.do_move(move);
 		stack->curr_move = move;
 
-		bool givesCheck = pos.in_check();
-		int16 extensions = givesCheck;
+		int16 extensions = givesCheck + singular;
 		int16 reductions = 1;
 
-		// 5. Reduce uninteresting quiet moves
+		// 7. Reduce uninteresting quiet moves
 		if (!pvNode &&
 			!improving &&
 			!hashOrKiller &&
@@ -533,7 +771,7 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 			bestScore <= alpha)
 			reductions += 1;
 
-		// 6. Extend likely interesting quiet moves 
+		// 8. Extend likely interesting quiet moves 
 		if (!pvNode &&
 			!improving &&
 			!hashOrKiller &&
@@ -544,7 +782,7 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 			(dangerousQuietCheck || advancedPawnPush || threatResponse))
 			extensions += 1;
 
-		// 7. Reduce losing captures
+		// 9. Reduce losing captures
 		//if (isCapture &&
 		//	!hashOrKiller &&
 		//	!givesCheck &&
@@ -556,10 +794,10 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 		//	SEE < 0)
 		//	reductions += 1;
 
-		// 8. Movecount pruning from Stockfish
+		// 10. Movecount pruning from Stockfish
 		skipQuiets = moves_searched >= futility_move_count(improving, depth);
 
-		// 9. Reduction if this position is being searched by another thread
+		// 11. Reduction if this position is being searched by another thread
 		//if (is_searching(pos, move, pos.id()))
 		//	reductions += 1;
 
@@ -568,34 +806,45 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 
 		Score score = Score::ninf;
 		if (moves_searched < 3) {
-			(stack + 1)->pv = pv;
+			(stack + 1)->cut_node = false;
+			(stack + 1)->pv = (stack + 1)->pv_row;
 			(stack + 1)->pv[0].set(A1, A1, Movetype::no_type);
 			score = Score(newdepth <= 1 ? -qsearch<Nodetype::pv>(pos, -beta, -alpha, 0, stack + 1) :
 				-search<Nodetype::pv>(pos, -beta, -alpha, newdepth - 1, stack + 1));
 		}
 		else {
 			int16 LMR = newdepth;
-			// Late move reduction for moves unlikely to raise alpha
-			if (!threatResponse &&
-				!hashOrKiller &&
-				!dangerousQuietCheck &&
-				!captureFollowup &&
-				!advancedPawnPush &&
-				!isPromotion &&
+
+			// Late move reduction : scaled by the move history and the expected node type,
+			// moves with tactical features are reduced a ply less
+			if (depth >= 3 &&
 				!isEvasion &&
-				!givesCheck &&
-				!anyPawnsOn7th &&
-				depth >= 3 &&
-				bestScore <= alpha) {
-				unsigned R = reduction(pvNode, improving, depth, moves_searched);
-				LMR -= R;
+				!isCapture &&
+				!isPromotion) {
+				int R = reduction(pvNode, improving, depth, moves_searched);
+				R -= hashOrKiller;
+				R -= (givesCheck || dangerousQuietCheck || threatResponse || advancedPawnPush || captureFollowup);
+				R -= anyPawnsOn7th;
+				if (!pvNode && stack->cut_node)
+					R += int(pos.params.lmr_cut_node);
+				if (isQuiet)
+					R -= int(history / pos.params.lmr_history_divisor);
+
+				LMR -= std::clamp(R, 0, std::max(newdepth - 1, 0));
 			}
 
+			(stack + 1)->cut_node = pvNode || !stack->cut_node;
 			score = Score(LMR <= 1 ? -qsearch<non_pv>(pos, -alpha - 1, -alpha, 0, stack + 1) :
 				-search<non_pv>(pos, -alpha - 1, -alpha, LMR - 1, stack + 1));
 
-			if (score > alpha) {
-				(stack + 1)->pv = pv;
+			// verify a reduced move that beat alpha at full depth before trusting it
+			if (score > alpha && LMR < newdepth)
+				score = Score(newdepth <= 1 ? -qsearch<non_pv>(pos, -alpha - 1, -alpha, 0, stack + 1) :
+					-search<non_pv>(pos, -alpha - 1, -alpha, newdepth - 1, stack + 1));
+
+			if (score > alpha && score < beta) {
+				(stack + 1)->cut_node = false;
+				(stack + 1)->pv = (stack + 1)->pv_row;
 				(stack + 1)->pv[0].set(A1, A1, Movetype::no_type);
 
 				score = Score(newdepth <= 1 ? -qsearch<Nodetype::pv>(pos, -beta, -alpha, 0, stack + 1) :
@@ -617,19 +866,18 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 
 		// root move update
 		if (root_node) {
-			auto& rm = *std::find(pos.root_moves.begin(), pos.root_moves.end(), move);
+			auto rm = std::find(pos.root_moves.begin(), pos.root_moves.end(), move);
 
 			if (moves_searched == 1 || score > alpha) {
-				rm.score = score;
-				rm.selDepth = selDepth;
-				rm.pv.resize(1);
-				for (Move* m = (stack + 1)->pv;; ++m) {
-					if (m->f == m->t || m->type == Movetype::no_type)
-						break;
-					rm.pv.push_back(*m);
-				}
+				rm->score = score;
+				rm->selDepth = selDepth;
+				rm->pv.load(move, (stack + 1)->pv);
+
+				// each scored move beats the ones before it, moving it to the front keeps the root moves
+				// ranked (unscored moves keep their order) without sorting after the search
+				std::rotate(pos.root_moves.begin(), rm, rm + 1);
 			}
-			else rm.score = Score::ninf;
+			else rm->score = Score::ninf;
 		}
 
 		if (score > bestScore) {
@@ -638,9 +886,12 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 			stack->best_move = move;
 
 			if (score >= beta) {
+				++thread.failHighs;
+				thread.failHighsFirst += (moves_searched == 1);
+
 				// Update mate killers and quiet move stats
 				pos.stats_update(best_move,
-					(stack - 1)->curr_move,
+					stack,
 					depth, bestScore, quiets, stack->killers);
 				break;
 			}
@@ -678,12 +929,15 @@ Score Search::search(position& pos, int16 alpha, int16 beta, U16 depth, node* st
 
 
 	if (moves_searched == 0) {
+		if (excluded)
+			return Score(alpha); // the excluded move is the only one
 		return (in_check ? Score(Score::mated + root_dist) : Score::draw);
 	}
 
 	Bound bound = (bestScore >= beta ? bound_low :
 		pvNode && (best_move.type != Movetype::no_type) ? bound_exact : bound_high);
-	ttable.save(pos.key(), depth, U8(bound), stack->ply, best_move, bestScore, pvNode);
+	if (!excluded)
+		ttable.save(pos.key(), depth, U8(bound), best_move, bestScore, tt_eval, pos.verify_key());
 
 	return bestScore;
 }
@@ -712,6 +966,9 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 	bool in_check = p.in_check();
 	stack->in_check = in_check;
 
+	if (root_dist >= Depth::MAX_PLY)
+		return in_check ? Score::draw : Score(std::lround(eval::evaluate(p, *SearchThreads[p.id()], -1)));
+
 	//if (/*!root_node &&*/ !in_check && p.is_draw()) {
 	//	//alpha = draw;
 	//	//if (alpha >= beta)
@@ -720,10 +977,13 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 
 	hash_data e;
 	e.depth = 0;
+	bool hashHit = false;
 	{  // hashtable lookup
-		if (ttable.fetch(p.key(), e)) {
+		if (ttable.fetch(p.key(), e, p.verify_key())) {
+			hashHit = true;
 			ttm = e.move;
-			ttvalue = Score(e.score);
+			if (e.bound != no_bound)
+				ttvalue = Score(e.score);
 			hashHits++;
 
 			if (!pv_type &&
@@ -738,12 +998,25 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 	const bool anyPawnsOn7th = p.pawns_near_promotion(); // either side has pawns on 7th
 	
 
+	Score tt_eval = Score::ninf;
 	if (!in_check) {
+		Searchthread& thread = *SearchThreads[p.id()];
+		if (hashHit && e.eval != Score::ninf) {
+			tt_eval = Score(e.eval);
+			++thread.ttEvals;
+		}
+
 		// Compute the best score
 		if (!pv_type && ttvalue != Score::ninf && e.depth >= depth)
 			best_score = ttvalue;
-		else
-			best_score = (Score)std::lround(eval::evaluate(p, *SearchThreads[p.id()], lazy_eval_margin(qsdepth, anyPawnsOn7th)));
+		else if (tt_eval != Score::ninf)
+			best_score = tt_eval;
+		else {
+			bool lazy = false;
+			best_score = (Score)std::lround(eval::evaluate(p, thread, lazy_eval_margin(qsdepth, anyPawnsOn7th), &lazy));
+			++thread.fullEvals;
+			if (!lazy) tt_eval = best_score;
+		}
 		
 		// Stand pat
 		if (best_score >= beta)
@@ -764,7 +1037,11 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 
 	U16 moves_searched = 0;
 
-	haVoc::QMoveorder mvs(p, ttm, stack);
+	// quiet checks are only generated at the first qsearch ply, the replies to them are evasions
+	const bool gen_checks = stack->gen_checks && !in_check && p.params.qsearch_checks;
+	(stack + 1)->gen_checks = false;
+
+	haVoc::QMoveorder mvs(p, ttm, stack, gen_checks);
 	Move move;
 	Move pre_move = (stack - 1)->curr_move;
 	Move pre_pre_move = (stack - 2)->curr_move;
@@ -826,7 +1103,11 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 				continue;
 		}
 
-		if (p.see(move) < 0)
+		// a quiet hash move is kept only if it checks, evasions are all searched (no false mates)
+		if (isQuiet && !in_check && !p.gives_check(move))
+			continue;
+
+		if (!in_check && !p.see_ge(move, 0))
 			continue;
 
 		p.do_move(move);
@@ -862,7 +1143,7 @@ Score Search::qsearch(position& p, int16 alpha, int16 beta, U16 depth, node* sta
 	
 	Bound bound = (best_score >= beta ? bound_low :
 	  pv_type && (best_move.type != Movetype::no_type) ? bound_exact : bound_high);
-	ttable.save(p.key(), qsdepth, U8(bound), stack->ply, best_move, best_score, pv_type);
+	ttable.save(p.key(), qsdepth, U8(bound), best_move, best_score, tt_eval, p.verify_key());
 
 	return best_score;
 }
@@ -882,35 +1163,41 @@ void Search::readout_pv(node* stack, const Rootmoves& mRoots, const Score& eval,
 	std::unique_lock<std::mutex> lock(search_mtx);
 
 	U64 nodes = 0;
+	U64 tbHits = 0;
 	for (auto& t : mPositions) {
 		nodes += t->nodes();
 		nodes += t->qnodes();
+		tbHits += SearchThreads[t->id()]->tbHits;
 	}
 
-	auto numLines = opts->value<int>("multipv");
+	auto numLines = std::min(size_t(opts->value<int>("multipv")), mRoots.size());
 
-	for (int i = 0; i < numLines; ++i)
+	// the first line carries the window result, the others the last score each root move got
+	// (moves not scored in this iteration report their previous score, never scored moves are skipped)
+	for (size_t i = 0, line = 1; i < mRoots.size() && line <= numLines; ++i)
 	{
-		std::string res = "";
+		const Score score = (i == 0 ? eval : mRoots[i].score != Score::ninf ? mRoots[i].score : mRoots[i].prevScore);
+		if (score == Score::ninf)
+			continue;
 
+		info_out << "info"
+			<< " depth " << depth
+			<< (i > 0 ? "" : eval >= beta ? " lowerbound" : eval <= alpha ? " upperbound" : "")
+			<< " seldepth " << mRoots[i].selDepth
+			<< " multipv " << line++
+			<< " score cp " << int(score)
+			<< " nodes " << nodes
+			<< " tbhits " << tbHits
+			<< " time " << int(elapsed)
+			<< " pv";
 
-		for (auto& m : mRoots[i].pv) {
+		for (const Move& m : mRoots[i].pv) {
 			if (m.f == m.t || m.type == Movetype::no_type)
 				break;
-			res += uci::move_to_string(m) + " ";
+			info_out << " " << m;
 		}
-
-		std::cout << "info"
-			<< " depth " << depth
-			<< (eval >= beta ? " lowerbound" : eval <= alpha ? " upperbound" : "")
-			<< " seldepth " << mRoots[i].selDepth
-			<< " multipv " << i
-			<< " score cp " << eval // TODO: support multipv
-			<< " nodes " << nodes
-			<< " tbhits " << hashHits
-			<< " time " << (int)elapsed
-			//<< " nps " << (nodes * 1000 / elapsed)
-			<< " pv " << res << std::endl;
+		info_out << "\n";
 	}
 
+	info_out.flush(std::cout);
 }
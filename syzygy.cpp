@@ -0,0 +1,1113 @@
+// Reader for the Syzygy endgame tablebases, the file format and probing rules are those of
+// Ronald de Man's table generator (https://github.com/syzygy1/tb).
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "syzygy.h"
+#include "move.h"
+
+
+namespace {
+
+	const int max_men = 6;
+	const U32 wdl_magic = 0x5d23e871;
+	const U32 dtz_magic = 0xa50c66d7;
+
+	inline U16 read16(const U8* p) { return U16(p[0] | (p[1] << 8)); }
+	inline U32 read32(const U8* p) { return U32(read16(p)) | (U32(read16(p + 2)) << 16); }
+	inline U32 read32_be(const U8* p) { return (U32(p[0]) << 24) | (U32(p[1]) << 16) | (U32(p[2]) << 8) | U32(p[3]); }
+	inline U64 read64_be(const U8* p) { return (U64(read32_be(p)) << 32) | read32_be(p + 4); }
+
+
+	// ------- index tables ------- //
+
+	U64 binomial[max_men + 1][64]; // binomial[k][n] = n choose k
+	int kk_index[10][64]; // two kings, the first in the a1-d1-d4 triangle (-1 : not a legal placement)
+	U64 pawn_index[max_men][24]; // leading pawns, first pawn on flap(sq) and the others with a lower twist
+	U64 pawn_factor[max_men][4]; // leading pawn placements for each file a-d
+
+	inline int file_of(const int& s) { return s & 7; }
+	inline int rank_of(const int& s) { return s >> 3; }
+	inline int transpose(const int& s) { return (s >> 3) | ((s & 7) << 3); }
+
+	// > 0 below the a1-h8 diagonal (rank > file), < 0 above it, 0 on it
+	inline int off_diagonal(const int& s) { return rank_of(s) - file_of(s); }
+
+	// a1-d1-d4 triangle : squares off the diagonal first (b1 c1 d1 c2 d2 d3) then a1 b2 c3 d4
+	inline int triangle(const int& s) {
+		static const int quadrant[16] = { 6, 0, 1, 2, 0, 7, 3, 4, 1, 3, 8, 5, 2, 4, 5, 9 };
+		return quadrant[rank_of(s) * 4 + file_of(s)];
+	}
+
+	// squares above the a1-h8 diagonal numbered 0..27 rank by rank (b1 = 0, c1 = 1 .. h7 = 27)
+	inline int upper(const int& s) {
+		const int r = rank_of(s);
+		return r * 7 - r * (r - 1) / 2 + file_of(s) - r - 1;
+	}
+
+	// leading pawn on files a-d : 6 squares per file, a2 = 0 .. d7 = 23 (files e-h mirrored)
+	inline int flap(const int& s) {
+		return std::min(file_of(s), 7 - file_of(s)) * 6 + rank_of(s) - 1;
+	}
+
+	// pawn order used for the other leading pawns : central files and advanced ranks come first
+	inline int twist(const int& s) {
+		const int f = file_of(s);
+		return (3 - std::min(f, 7 - f)) * 12 + (6 - rank_of(s)) * 2 + (f < 4 ? 1 : 0);
+	}
+
+	void init_indices() {
+		for (int k = 0; k <= max_men; ++k) {
+			for (int n = 0; n < 64; ++n)
+				binomial[k][n] = (k == 0 ? 1 : n == 0 ? 0 : binomial[k - 1][n - 1] + binomial[k][n - 1]);
+		}
+
+		for (int t = 0; t < max_men; ++t) {
+			for (int f = 0; f < 4; ++f) {
+				U64 s = 0;
+				for (int r = 0; r < 6; ++r) {
+					const int j = f * 6 + r;
+					pawn_index[t][j] = s;
+					const int sq = (r + 1) * 8 + f;
+					s += (t == 0 ? 1 : binomial[t][twist(sq)]);
+				}
+				pawn_factor[t][f] = s;
+			}
+		}
+
+		// kings not in contact, the first one in the triangle, the second not above the diagonal when the
+		// first is on it : 462 placements, the ones with both kings on the diagonal are numbered last
+		int code = 0;
+		std::vector<std::pair<int, int>> both_diagonal;
+		for (int t = 0; t < 10; ++t) {
+			int s1 = 0;
+			while (s1 < 28 && !(file_of(s1) < 4 && rank_of(s1) < 4 && triangle(s1) == t && off_diagonal(s1) <= 0))
+				++s1;
+			for (int s2 = 0; s2 < 64; ++s2) {
+				kk_index[t][s2] = -1;
+				if (s1 == s2 || (bitboards::kmask[s1] & bitboards::squares[s2]))
+					continue;
+				if (off_diagonal(s1) == 0 && off_diagonal(s2) > 0)
+					continue;
+				if (off_diagonal(s1) == 0 && off_diagonal(s2) == 0)
+					both_diagonal.emplace_back(t, s2);
+				else
+					kk_index[t][s2] = code++;
+			}
+		}
+		for (const auto& kk : both_diagonal)
+			kk_index[kk.first][kk.second] = code++;
+	}
+
+
+	// ------- memory mapped files ------- //
+
+	struct mapped_file {
+		const U8* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		HANDLE mapping = nullptr;
+#endif
+
+		bool open(const std::string& path) {
+#ifdef _WIN32
+			HANDLE fd = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_FLAG_RANDOM_ACCESS, nullptr);
+			if (fd == INVALID_HANDLE_VALUE)
+				return false;
+			DWORD high = 0;
+			const DWORD low = GetFileSize(fd, &high);
+			size = (size_t(high) << 32) | low;
+			mapping = (size > 0 ? CreateFileMapping(fd, nullptr, PAGE_READONLY, high, low, nullptr) : nullptr);
+			CloseHandle(fd);
+			if (!mapping)
+				return false;
+			data = static_cast<const U8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (!data) {
+				CloseHandle(mapping);
+				mapping = nullptr;
+			}
+			return data != nullptr;
+#else
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd == -1)
+				return false;
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+				::close(fd);
+				return false;
+			}
+			size = size_t(st.st_size);
+			void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (m == MAP_FAILED)
+				return false;
+#ifdef MADV_RANDOM
+			madvise(m, size, MADV_RANDOM);
+#endif
+			data = static_cast<const U8*>(m);
+			return true;
+#endif
+		}
+
+		void close() {
+			if (!data)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+			mapping = nullptr;
+#else
+			munmap(const_cast<U8*>(data), size);
+#endif
+			data = nullptr;
+			size = 0;
+		}
+	};
+
+
+	// ------- table layout ------- //
+
+	/// <summary>
+	/// One compressed value stream : blocks of canonical huffman codes whose symbols expand into runs of values.
+	/// The index table points every 2^idx_bits positions into the block list, the size table holds
+	/// the number of values (minus one) of each block.
+	/// </summary>
+	struct pairs_data {
+		const U8* index_table = nullptr;
+		const U8* size_table = nullptr;
+		const U8* blocks = nullptr;
+		const U8* symbols = nullptr; // 3 bytes per symbol : two 12 bit children, or a value and 0xfff
+		const U8* offsets = nullptr; // 16 bit first symbol of each code length
+		std::vector<U8> symbol_len; // values covered by the symbol minus one
+		std::vector<U64> base; // smallest code of each length, left aligned
+		int block_bits = 0;
+		int idx_bits = 0; // 0 : every position has the same value
+		int min_len = 0;
+		U8 flags = 0;
+		U8 constant = 0;
+		U64 index_bytes = 0, size_bytes = 0, block_bytes = 0;
+	};
+
+	/// <summary>
+	/// Placement of the men for one side to move (and one leading pawn file) : men are encoded group by group,
+	/// the order of the groups in the index is stored with the table.
+	/// </summary>
+	struct encoding {
+		U8 codes[max_men] = {}; // piece codes : 1-6 pawn..king, +8 for black
+		U8 group[max_men] = {}; // group length at the first man of each group
+		U64 factor[max_men] = {};
+		int order = 0, order2 = 0x0f;
+		U64 size = 0;
+		pairs_data pairs;
+		U16 map_index[4] = {}; // dtz : value maps for win, loss, cursed win, blessed loss
+	};
+
+	struct table {
+		std::string wdl_path, dtz_path;
+		U64 key = 0; // white and black material as in the file name
+		U64 flipped_key = 0;
+		int men = 0;
+		bool symmetric = false;
+		bool has_pawns = false;
+		bool unique3 = false; // three or more men alone of their kind : the first three are placed together
+		int lead_pawns = 0, other_pawns = 0;
+
+		std::mutex load_mtx;
+		std::atomic<int> wdl_state{ 0 }, dtz_state{ 0 }; // 0 not mapped yet, 1 ready, -1 unusable
+		mapped_file wdl_file, dtz_file;
+		encoding wdl[4][2];
+		int wdl_sides = 0;
+		encoding dtz[4];
+		const U8* dtz_map = nullptr;
+	};
+
+	std::vector<std::unique_ptr<table>> tables;
+	std::unordered_map<U64, table*> by_key;
+	int largest = 0;
+
+	// a 4 bit count for each piece but the king, white then black
+	inline U64 material_key(const int counts[colors][pieces], const bool& flip) {
+		U64 k = 0;
+		for (int c = white; c <= black; ++c) {
+			for (int p = pawn; p < king; ++p)
+				k |= U64(counts[c ^ flip][p]) << (4 * (c * 5 + p));
+		}
+		return k;
+	}
+
+	inline U64 material_key(const position& pos) {
+		int counts[colors][pieces] = {};
+		for (int c = white; c <= black; ++c) {
+			for (int p = pawn; p < king; ++p)
+				counts[c][p] = pos.number_of(Color(c), Piece(p));
+		}
+		return material_key(counts, false);
+	}
+
+	bool parse_name(const std::string& name, int counts[colors][pieces]) {
+		const std::string letters = "PNBRQK";
+		const size_t v = name.find('v');
+		if (v == std::string::npos || v == 0 || v + 1 >= name.size())
+			return false;
+		for (size_t i = 0; i < name.size(); ++i) {
+			if (i == v)
+				continue;
+			const size_t p = letters.find(name[i]);
+			if (p == std::string::npos)
+				return false;
+			++counts[i < v ? white : black][p];
+		}
+		return counts[white][king] == 1 && counts[black][king] == 1;
+	}
+
+	void add_table(const std::string& dir, const std::string& name) {
+		int counts[colors][pieces] = {};
+		if (!parse_name(name, counts))
+			return;
+
+		auto t = std::make_unique<table>();
+		for (int c = white; c <= black; ++c) {
+			for (int p = pawn; p <= king; ++p)
+				t->men += counts[c][p];
+		}
+		if (t->men > max_men)
+			return;
+
+		t->key = material_key(counts, false);
+		t->flipped_key = material_key(counts, true);
+		if (by_key.count(t->key))
+			return; // same table in an earlier directory
+
+		t->wdl_path = (std::filesystem::path(dir) / (name + ".rtbw")).string();
+		const auto dtz = std::filesystem::path(dir) / (name + ".rtbz");
+		std::error_code ec;
+		if (std::filesystem::exists(dtz, ec))
+			t->dtz_path = dtz.string();
+
+		t->symmetric = (t->key == t->flipped_key);
+		t->has_pawns = (counts[white][pawn] + counts[black][pawn]) > 0;
+
+		int singles = 0;
+		for (int c = white; c <= black; ++c) {
+			for (int p = pawn; p <= king; ++p)
+				singles += (counts[c][p] == 1);
+		}
+		t->unique3 = (singles >= 3);
+
+		// the leading pawns are those of the side with fewer (but some) pawns
+		t->lead_pawns = counts[white][pawn];
+		t->other_pawns = counts[black][pawn];
+		if (counts[black][pawn] > 0 && (counts[white][pawn] == 0 || counts[black][pawn] < counts[white][pawn]))
+			std::swap(t->lead_pawns, t->other_pawns);
+
+		largest = std::max(largest, t->men);
+		by_key[t->key] = t.get();
+		by_key[t->flipped_key] = t.get();
+		tables.push_back(std::move(t));
+	}
+
+
+	// ------- table loading ------- //
+
+	inline const U8* align(const U8* base, const U8* p, const size_t& n) {
+		const size_t off = size_t(p - base);
+		return base + (off + n - 1) / n * n;
+	}
+
+	void set_groups(const table& t, encoding& e) {
+		std::fill(std::begin(e.group), std::end(e.group), U8(0));
+		int i = 0;
+		if (t.has_pawns) {
+			e.group[0] = U8(t.lead_pawns);
+			if (t.other_pawns)
+				e.group[t.lead_pawns] = U8(t.other_pawns);
+			i = t.lead_pawns + t.other_pawns;
+		}
+		else {
+			e.group[0] = U8(t.unique3 ? 3 : 2);
+			i = e.group[0];
+		}
+		for (; i < t.men; i += e.group[i]) {
+			for (int j = i; j < t.men && e.codes[j] == e.codes[i]; ++j)
+				++e.group[i];
+		}
+	}
+
+	U64 piece_factors(const table& t, encoding& e) {
+		const U64 lead_placements = (t.unique3 ? 31332 : 462);
+		int free_squares = 64 - e.group[0];
+		U64 f = 1;
+		for (int i = e.group[0], k = 0; i < t.men || k == e.order; ++k) {
+			if (k == e.order) {
+				e.factor[0] = f;
+				f *= lead_placements;
+			}
+			else {
+				e.factor[i] = f;
+				f *= binomial[e.group[i]][free_squares];
+				free_squares -= e.group[i];
+				i += e.group[i];
+			}
+		}
+		return f;
+	}
+
+	U64 pawn_factors(const table& t, encoding& e, const int& file) {
+		const int lead = e.group[0];
+		int i = lead + (e.order2 < 0x0f ? e.group[lead] : 0);
+		int free_squares = 64 - i;
+		U64 f = 1;
+		for (int k = 0; i < t.men || k == e.order || k == e.order2; ++k) {
+			if (k == e.order) {
+				e.factor[0] = f;
+				f *= pawn_factor[lead - 1][file];
+			}
+			else if (k == e.order2) {
+				e.factor[lead] = f;
+				f *= binomial[e.group[lead]][48 - lead];
+			}
+			else {
+				e.factor[i] = f;
+				f *= binomial[e.group[i]][free_squares];
+				free_squares -= e.group[i];
+				i += e.group[i];
+			}
+		}
+		return f;
+	}
+
+	// piece list header : the group order byte(s) then a code per man, low nibbles for the first stored side
+	void read_pieces(const table& t, encoding& e, const U8* p, const int& side, const int& file) {
+		const int shift = (side ? 4 : 0);
+		const bool two_orders = (t.has_pawns && t.other_pawns > 0);
+		e.order = (p[0] >> shift) & 0x0f;
+		e.order2 = (two_orders ? (p[1] >> shift) & 0x0f : 0x0f);
+		for (int i = 0; i < t.men; ++i)
+			e.codes[i] = (p[i + 1 + two_orders] >> shift) & 0x0f;
+		set_groups(t, e);
+		e.size = (t.has_pawns ? pawn_factors(t, e, file) : piece_factors(t, e));
+	}
+
+	void symbol_length(pairs_data& d, const int& s, std::vector<bool>& done) {
+		if (done[s])
+			return;
+		const U8* w = d.symbols + 3 * s;
+		const int right = (w[2] << 4) | (w[1] >> 4);
+		if (right == 0xfff)
+			d.symbol_len[s] = 0;
+		else {
+			const int left = ((w[1] & 0x0f) << 8) | w[0];
+			symbol_length(d, left, done);
+			symbol_length(d, right, done);
+			d.symbol_len[s] = U8(d.symbol_len[left] + d.symbol_len[right] + 1);
+		}
+		done[s] = true;
+	}
+
+	const U8* read_pairs(pairs_data& d, const U8* p, const U64& positions, const bool& wdl) {
+		d.flags = p[0];
+		if (p[0] & 0x80) {
+			d.idx_bits = 0;
+			d.constant = (wdl ? p[1] : 0);
+			return p + 2;
+		}
+
+		d.block_bits = p[1];
+		d.idx_bits = p[2];
+		const U32 real_blocks = read32(p + 4);
+		const U32 blocks = real_blocks + p[3];
+		const int max_len = p[8];
+		d.min_len = p[9];
+		const int lengths = max_len - d.min_len + 1;
+		d.offsets = p + 10;
+		const int symbols = read16(p + 10 + 2 * lengths);
+		d.symbols = p + 12 + 2 * lengths;
+
+		d.index_bytes = 6 * ((positions + (1ULL << d.idx_bits) - 1) >> d.idx_bits);
+		d.size_bytes = 2ULL * blocks;
+		d.block_bytes = U64(real_blocks) << d.block_bits;
+
+		d.symbol_len.assign(symbols, 0);
+		std::vector<bool> done(symbols, false);
+		for (int s = 0; s < symbols; ++s)
+			symbol_length(d, s, done);
+
+		d.base.assign(lengths, 0);
+		for (int i = lengths - 2; i >= 0; --i) {
+			const int64_t b = int64_t(d.base[i + 1]) + read16(d.offsets + 2 * i) - read16(d.offsets + 2 * (i + 1));
+			d.base[i] = U64(b / 2);
+		}
+		for (int i = 0; i < lengths; ++i)
+			d.base[i] <<= 64 - (d.min_len + i);
+
+		return p + 12 + 2 * lengths + 3 * symbols + (symbols & 1);
+	}
+
+	inline int wdl_files(const table& t) { return t.has_pawns ? 4 : 1; }
+
+	bool load_wdl(table& t) {
+		if (!t.wdl_file.open(t.wdl_path))
+			return false;
+		const U8* base = t.wdl_file.data;
+		if (t.wdl_file.size < 6 || read32(base) != wdl_magic || bool(base[4] & 0x02) != t.has_pawns)
+			return false;
+
+		const int files = wdl_files(t);
+		t.wdl_sides = (base[4] & 0x01) ? 2 : 1;
+		const int header = t.men + 1 + (t.has_pawns && t.other_pawns > 0);
+
+		const U8* p = base + 5;
+		for (int f = 0; f < files; ++f, p += header) {
+			for (int s = 0; s < 2; ++s)
+				read_pieces(t, t.wdl[f][s], p, s, f);
+		}
+		p = align(base, p, 2);
+
+		for (int f = 0; f < files; ++f) {
+			for (int s = 0; s < t.wdl_sides; ++s)
+				p = read_pairs(t.wdl[f][s].pairs, p, t.wdl[f][s].size, true);
+		}
+		for (int f = 0; f < files; ++f) {
+			for (int s = 0; s < t.wdl_sides; ++s) {
+				t.wdl[f][s].pairs.index_table = p;
+				p += t.wdl[f][s].pairs.index_bytes;
+			}
+		}
+		for (int f = 0; f < files; ++f) {
+			for (int s = 0; s < t.wdl_sides; ++s) {
+				t.wdl[f][s].pairs.size_table = p;
+				p += t.wdl[f][s].pairs.size_bytes;
+			}
+		}
+		for (int f = 0; f < files; ++f) {
+			for (int s = 0; s < t.wdl_sides; ++s) {
+				p = align(base, p, 64);
+				t.wdl[f][s].pairs.blocks = p;
+				p += t.wdl[f][s].pairs.block_bytes;
+			}
+		}
+		return size_t(p - base) <= t.wdl_file.size;
+	}
+
+	bool load_dtz(table& t) {
+		if (t.dtz_path.empty() || !t.dtz_file.open(t.dtz_path))
+			return false;
+		const U8* base = t.dtz_file.data;
+		if (t.dtz_file.size < 6 || read32(base) != dtz_magic || bool(base[4] & 0x02) != t.has_pawns)
+			return false;
+
+		const int files = wdl_files(t);
+		const int header = t.men + 1 + (t.has_pawns && t.other_pawns > 0);
+
+		const U8* p = base + 5;
+		for (int f = 0; f < files; ++f, p += header)
+			read_pieces(t, t.dtz[f], p, 0, f);
+		p = align(base, p, 2);
+
+		for (int f = 0; f < files; ++f)
+			p = read_pairs(t.dtz[f].pairs, p, t.dtz[f].size, false);
+
+		// value maps (one byte per value, 16 bit maps of 7 men tables are not supported)
+		t.dtz_map = p;
+		for (int f = 0; f < files; ++f) {
+			if (t.dtz[f].pairs.flags & 0x10)
+				return false;
+			if (t.dtz[f].pairs.flags & 0x02) {
+				for (int i = 0; i < 4; ++i) {
+					t.dtz[f].map_index[i] = U16(p + 1 - t.dtz_map);
+					p += 1 + p[0];
+				}
+			}
+		}
+		p = align(base, p, 2);
+
+		for (int f = 0; f < files; ++f) {
+			t.dtz[f].pairs.index_table = p;
+			p += t.dtz[f].pairs.index_bytes;
+		}
+		for (int f = 0; f < files; ++f) {
+			t.dtz[f].pairs.size_table = p;
+			p += t.dtz[f].pairs.size_bytes;
+		}
+		for (int f = 0; f < files; ++f) {
+			p = align(base, p, 64);
+			t.dtz[f].pairs.blocks = p;
+			p += t.dtz[f].pairs.block_bytes;
+		}
+		return size_t(p - base) <= t.dtz_file.size;
+	}
+
+	// maps the file on the first probe, later probes only read the state
+	bool ready(table& t, const bool& dtz) {
+		std::atomic<int>& state = (dtz ? t.dtz_state : t.wdl_state);
+		const int s = state.load(std::memory_order_acquire);
+		if (s != 0)
+			return s > 0;
+
+		std::lock_guard<std::mutex> lock(t.load_mtx);
+		if (state.load(std::memory_order_relaxed) == 0) {
+			const bool ok = (dtz ? load_dtz(t) : load_wdl(t));
+			if (!ok)
+				(dtz ? t.dtz_file : t.wdl_file).close();
+			state.store(ok ? 1 : -1, std::memory_order_release);
+		}
+		return state.load(std::memory_order_relaxed) > 0;
+	}
+
+
+	// ------- decoding ------- //
+
+	U8 decompress(const pairs_data& d, const U64& idx) {
+		if (d.idx_bits == 0)
+			return d.constant;
+
+		const U64 main_idx = idx >> d.idx_bits;
+		int lit = int(idx & ((1ULL << d.idx_bits) - 1)) - (1 << (d.idx_bits - 1));
+		U32 block = read32(d.index_table + 6 * main_idx);
+		lit += read16(d.index_table + 6 * main_idx + 4);
+
+		// walk from the indexed block to the one holding the value
+		while (lit < 0)
+			lit += read16(d.size_table + 2 * (--block)) + 1;
+		while (lit > read16(d.size_table + 2 * block))
+			lit -= read16(d.size_table + 2 * (block++)) + 1;
+
+		const U8* ptr = d.blocks + (U64(block) << d.block_bits);
+		U64 code = read64_be(ptr);
+		ptr += 8;
+		int used = 0; // bits shifted out of 'code' since the last refill
+		int sym = 0;
+		for (;;) {
+			int l = 0;
+			while (code < d.base[l])
+				++l;
+			const int len = l + d.min_len;
+			sym = read16(d.offsets + 2 * l) + int((code - d.base[l]) >> (64 - len));
+			if (lit < int(d.symbol_len[sym]) + 1)
+				break;
+			lit -= int(d.symbol_len[sym]) + 1;
+			code <<= len;
+			used += len;
+			if (used >= 32) {
+				used -= 32;
+				code |= U64(read32_be(ptr)) << used;
+				ptr += 4;
+			}
+		}
+
+		// descend the pair tree to the value
+		while (d.symbol_len[sym] != 0) {
+			const U8* w = d.symbols + 3 * sym;
+			const int left = ((w[1] & 0x0f) << 8) | w[0];
+			if (lit < int(d.symbol_len[left]) + 1)
+				sym = left;
+			else {
+				lit -= int(d.symbol_len[left]) + 1;
+				sym = (w[2] << 4) | (w[1] >> 4);
+			}
+		}
+		return d.symbols[3 * sym];
+	}
+
+	U64 encode_groups(const table& t, const encoding& e, int* sq, int i, bool pawn_group) {
+		U64 idx = 0;
+		while (i < t.men) {
+			const int len = e.group[i];
+			std::sort(sq + i, sq + i + len);
+			U64 s = 0;
+			for (int m = i; m < i + len; ++m) {
+				int skip = (pawn_group ? 8 : 0);
+				for (int k = 0; k < i; ++k)
+					skip += (sq[m] > sq[k]);
+				s += binomial[m - i + 1][sq[m] - skip];
+			}
+			idx += s * e.factor[i];
+			pawn_group = false;
+			i += len;
+		}
+		return idx;
+	}
+
+	U64 encode_pieces(const table& t, const encoding& e, int* sq) {
+		// first man to the a1-d1-d4 triangle, then the first of the leading men off the diagonal below it
+		if (sq[0] & 0x04) {
+			for (int i = 0; i < t.men; ++i)
+				sq[i] ^= 0x07;
+		}
+		if (sq[0] & 0x20) {
+			for (int i = 0; i < t.men; ++i)
+				sq[i] ^= 0x38;
+		}
+		const int lead = (t.unique3 ? 3 : 2);
+		for (int i = 0; i < lead; ++i) {
+			if (off_diagonal(sq[i]) == 0)
+				continue;
+			if (off_diagonal(sq[i]) > 0) {
+				for (int j = 0; j < t.men; ++j)
+					sq[j] = transpose(sq[j]);
+			}
+			break;
+		}
+
+		U64 idx = 0;
+		if (t.unique3) {
+			const int a = (sq[1] > sq[0]);
+			const int b = (sq[2] > sq[0]) + (sq[2] > sq[1]);
+			if (off_diagonal(sq[0]))
+				idx = U64(triangle(sq[0])) * 63 * 62 + (sq[1] - a) * 62 + (sq[2] - b);
+			else if (off_diagonal(sq[1]))
+				idx = 6 * 63 * 62 + rank_of(sq[0]) * 28 * 62 + upper(sq[1]) * 62 + (sq[2] - b);
+			else if (off_diagonal(sq[2]))
+				idx = 6 * 63 * 62 + 4 * 28 * 62 + rank_of(sq[0]) * 7 * 28 + (rank_of(sq[1]) - a) * 28 + upper(sq[2]);
+			else
+				idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rank_of(sq[0]) * 7 * 6 + (rank_of(sq[1]) - a) * 6 + (rank_of(sq[2]) - b);
+		}
+		else idx = U64(kk_index[triangle(sq[0])][sq[1]]);
+
+		return idx * e.factor[0] + encode_groups(t, e, sq, lead, false);
+	}
+
+	U64 encode_pawns(const table& t, const encoding& e, int* sq) {
+		if (sq[0] & 0x04) {
+			for (int i = 0; i < t.men; ++i)
+				sq[i] ^= 0x07;
+		}
+		const int lead = t.lead_pawns;
+		std::sort(sq + 1, sq + lead, [](const int& a, const int& b) { return twist(a) > twist(b); });
+
+		U64 idx = pawn_index[lead - 1][flap(sq[0])];
+		for (int i = 1; i < lead; ++i)
+			idx += binomial[lead - i][twist(sq[i])];
+
+		return idx * e.factor[0] + encode_groups(t, e, sq, lead, t.other_pawns > 0);
+	}
+
+	// squares of the men listed by 'codes' from 'i' on, colors swapped by 'cflip' and squares by 'sflip'
+	int collect(const position& p, const U8* codes, const int& men, int i, const int& cflip, const int& sflip, int* sq) {
+		while (i < men) {
+			const int code = codes[i] ^ cflip;
+			U64 b = p.get_pieces(Color(code >> 3), Piece((code & 7) - 1));
+			while (b && i < men)
+				sq[i++] = bits::pop_lsb(b) ^ sflip;
+		}
+		return i;
+	}
+
+	/// <summary>
+	/// Reads the value stored for the position (wdl : 0..4, dtz : raw dtz value), the side stored in the table
+	/// is the side to move of the position as named by the file, colors are swapped (and for pawns the board
+	/// flipped) when the position has the material the other way round. 'state' is 0 when the table
+	/// is missing, -1 when the dtz table only holds the other side to move.
+	/// </summary>
+	int read_table(position& p, const bool& dtz, const int& wdl, int& state) {
+		const U64 key = material_key(p);
+		auto it = by_key.find(key);
+		if (it == by_key.end() || !ready(*it->second, dtz)) {
+			state = 0;
+			return 0;
+		}
+		table& t = *it->second;
+
+		int side = 0, cflip = 0, sflip = 0;
+		if (t.symmetric) {
+			const bool b = (p.to_move() == black);
+			cflip = (b ? 8 : 0);
+			sflip = (b ? 0x38 : 0);
+		}
+		else if (key == t.key)
+			side = (p.to_move() == black);
+		else {
+			side = (p.to_move() == white);
+			cflip = 8;
+			sflip = 0x38;
+		}
+
+		int sq[max_men];
+		int file = 0;
+		int n = 0;
+		if (t.has_pawns) {
+			const U8* lead = (dtz ? t.dtz[0].codes : t.wdl[0][0].codes);
+			n = collect(p, lead, t.lead_pawns, 0, cflip, sflip, sq);
+			for (int i = 1; i < t.lead_pawns; ++i) {
+				if (flap(sq[0]) > flap(sq[i]))
+					std::swap(sq[0], sq[i]);
+			}
+			file = std::min(file_of(sq[0]), 7 - file_of(sq[0]));
+		}
+
+		const encoding* e = nullptr;
+		if (dtz) {
+			e = &t.dtz[file];
+			if ((e->pairs.flags & 0x01) != side && !t.symmetric) {
+				state = -1;
+				return 0;
+			}
+		}
+		else {
+			if (side >= t.wdl_sides) {
+				state = 0;
+				return 0;
+			}
+			e = &t.wdl[file][side];
+		}
+
+		// pawnless tables are symmetric in all directions, the encoding normalizes the board itself
+		collect(p, e->codes, t.men, n, cflip, (t.has_pawns ? sflip : 0), sq);
+		const U64 idx = (t.has_pawns ? encode_pawns(t, *e, sq) : encode_pieces(t, *e, sq));
+		int v = decompress(e->pairs, idx);
+
+		if (dtz) {
+			static const int map_of[] = { 1, 3, 0, 2, 0 }; // wdl -2..2 to the value map
+			static const U8 in_plies[] = { 8, 0, 0, 0, 4 }; // flag set when wins (losses) are stored in plies
+			if (e->pairs.flags & 0x02)
+				v = t.dtz_map[e->map_index[map_of[wdl + 2]] + v];
+			if (!(e->pairs.flags & in_plies[wdl + 2]) || (wdl & 1))
+				v *= 2;
+		}
+		state = 1;
+		return v;
+	}
+
+
+	// ------- probing ------- //
+
+	inline bool is_capture(const Move& m) {
+		return m.type == capture || m.type == ep ||
+			(m.type >= capture_promotion_q && m.type <= capture_promotion_n);
+	}
+
+	inline bool has_legal_move(position& p) {
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size(); ++i) {
+			if (p.is_legal(mvs[i]))
+				return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// The tables don't keep the value of a position whose best move is a capture (ep aside), the captures
+	/// are searched first. 'state' : 0 failure, 1 table value, 2 a capture reaches beta (or wins).
+	/// </summary>
+	int probe_ab(position& p, int alpha, const int& beta, int& state) {
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size(); ++i) {
+			const Move m = mvs[i];
+			if (!is_capture(m) || m.type == ep || !p.is_legal(m))
+				continue;
+			p.do_move(m);
+			const int v = -probe_ab(p, -beta, -alpha, state);
+			p.undo_move(m);
+			if (state == 0)
+				return 0;
+			if (v > alpha) {
+				if (v >= beta) {
+					state = 2;
+					return v;
+				}
+				alpha = v;
+			}
+		}
+
+		const U64 key = material_key(p);
+		int v = 0;
+		if (key != 0ULL) { // bare kings are a draw without a table
+			v = read_table(p, false, 0, state) - 2;
+			if (state == 0)
+				return 0;
+		}
+		if (alpha >= v) {
+			state = 1 + (alpha > 0);
+			return alpha;
+		}
+		state = 1;
+		return v;
+	}
+
+	// en passant captures are not in the tables either : the best of them replaces the table value
+	// when it is better, or when it is forced
+	int resolve_ep(position& p, const int& v, int& state, const bool& dtz) {
+		static const int wdl_to_dtz[] = { -1, -101, 0, 101, 1 };
+		if (p.eps() == Square::no_square)
+			return v;
+
+		int best = -3;
+		bool other_moves = false;
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+		for (int i = 0; i < mvs.size(); ++i) {
+			const Move m = mvs[i];
+			if (!p.is_legal(m))
+				continue;
+			if (m.type != ep) {
+				other_moves = true;
+				continue;
+			}
+			p.do_move(m);
+			const int w = -probe_ab(p, -2, 2, state);
+			p.undo_move(m);
+			if (state == 0)
+				return 0;
+			best = std::max(best, w);
+		}
+		if (best == -3)
+			return v;
+
+		if (!dtz) {
+			if (best >= v || (v == 0 && !other_moves))
+				return best;
+			return v;
+		}
+
+		const int d = wdl_to_dtz[best + 2];
+		if (v < -100) return (d >= 0 ? d : v);
+		if (v < 0) return (d >= 0 || d < -100 ? d : v);
+		if (v > 100) return (d > 0 ? d : v);
+		if (v > 0) return (d == 1 ? d : v);
+		if (d >= 0 || !other_moves) return d;
+		return v;
+	}
+
+	int dtz_no_ep(position& p, int& state) {
+		const int wdl = probe_ab(p, -2, 2, state);
+		if (state == 0 || wdl == 0)
+			return 0;
+
+		// a winning capture : the capture itself is the zeroing move
+		if (state == 2)
+			return (wdl == 2 ? 1 : 101);
+
+		Movegen mvs(p);
+		mvs.generate<pseudo_legal, pieces>();
+
+		// same for a winning pawn move
+		if (wdl > 0) {
+			for (int i = 0; i < mvs.size(); ++i) {
+				const Move m = mvs[i];
+				if (p.piece_on(Square(m.f)) != pawn || is_capture(m) || !p.is_legal(m))
+					continue;
+				p.do_move(m);
+				const int v = -probe_ab(p, -2, -wdl + 1, state);
+				p.undo_move(m);
+				if (state == 0)
+					return 0;
+				if (v == wdl)
+					return (v == 2 ? 1 : 101);
+			}
+		}
+
+		int dtz = 1 + read_table(p, true, wdl, state);
+		if (state == 1) {
+			if (wdl & 1)
+				dtz += 100;
+			return (wdl >= 0 ? dtz : -dtz);
+		}
+		if (state == 0)
+			return 0;
+
+		// the table holds the other side to move : one ply of search over the moves that don't zero
+		state = 1;
+		if (wdl > 0) {
+			int best = 0xffff;
+			for (int i = 0; i < mvs.size(); ++i) {
+				const Move m = mvs[i];
+				if (is_capture(m) || p.piece_on(Square(m.f)) == pawn || !p.is_legal(m))
+					continue;
+				p.do_move(m);
+				bool ok = false;
+				const int v = -syzygy::probe_dtz(p, ok);
+				const bool mate = (v == 1 && p.in_check() && !has_legal_move(p)); // counts as a zeroing move
+				p.undo_move(m);
+				if (!ok) {
+					state = 0;
+					return 0;
+				}
+				const int d = (mate ? 1 : v + 1);
+				if (v > 0 && d < best)
+					best = d;
+			}
+			return best;
+		}
+
+		int best = -1;
+		for (int i = 0; i < mvs.size(); ++i) {
+			const Move m = mvs[i];
+			if (!p.is_legal(m))
+				continue;
+			p.do_move(m);
+			int v = 0;
+			if (p.move50() == 0) {
+				if (wdl == -2)
+					v = -1;
+				else {
+					v = probe_ab(p, 1, 2, state);
+					v = (v == 2 ? 0 : -101);
+				}
+			}
+			else {
+				bool ok = false;
+				v = -syzygy::probe_dtz(p, ok) - 1;
+				state = ok;
+			}
+			p.undo_move(m);
+			if (state == 0)
+				return 0;
+			best = std::min(best, v);
+		}
+		return best;
+	}
+}
+
+
+void syzygy::init(const std::string& paths) {
+	static bool indices = false;
+	if (!indices) {
+		init_indices();
+		indices = true;
+	}
+
+	for (auto& t : tables) {
+		t->wdl_file.close();
+		t->dtz_file.close();
+	}
+	tables.clear();
+	by_key.clear();
+	largest = 0;
+
+	if (paths.empty() || paths == "<empty>")
+		return;
+
+#ifdef _WIN32
+	const char separator = ';';
+#else
+	const char separator = ':';
+#endif
+
+	std::string list = paths;
+	for (const std::string& dir : util::split(list, separator)) {
+		std::error_code ec;
+		for (const auto& f : std::filesystem::directory_iterator(dir, ec)) {
+			if (f.path().extension() == ".rtbw")
+				add_table(dir, f.path().stem().string());
+		}
+	}
+
+	std::cout << "info string found " << tables.size() << " syzygy tables";
+	if (largest > 0)
+		std::cout << " (up to " << largest << " men)";
+	std::cout << std::endl;
+}
+
+int syzygy::max_pieces() {
+	return largest;
+}
+
+bool syzygy::covers(const position& p) {
+	return bits::count(p.all_pieces()) <= largest && !p.can_castle<white>() && !p.can_castle<black>();
+}
+
+int syzygy::probe_wdl(position& p, bool& ok) {
+	int state = 1;
+	int v = probe_ab(p, -2, 2, state);
+	if (state != 0)
+		v = resolve_ep(p, v, state, false);
+	ok = (state != 0);
+	return ok ? v : 0;
+}
+
+int syzygy::probe_dtz(position& p, bool& ok) {
+	int state = 1;
+	int v = dtz_no_ep(p, state);
+	if (state != 0)
+		v = resolve_ep(p, v, state, true);
+	ok = (state != 0);
+	return ok ? v : 0;
+}
+
+bool syzygy::filter_root_moves(position& p, Rootmoves& moves, bool& dtz_ranked) {
+	static const int wdl_to_dtz[] = { -1, -101, 0, 101, 1 };
+	const int cnt50 = p.move50();
+	std::vector<int> rank(moves.size(), 0);
+	bool ok = false;
+
+	const int dtz = probe_dtz(p, ok);
+	dtz_ranked = ok;
+	if (!dtz_ranked) {
+		probe_wdl(p, ok);
+		if (!ok)
+			return false;
+	}
+
+	for (size_t i = 0; i < moves.size(); ++i) {
+		const Move m = moves[i].pv[0];
+		p.do_move(m);
+		int v = 0;
+		if (p.in_check() && !has_legal_move(p))
+			v = (dtz_ranked ? 1 : 2); // mate
+		else if (!dtz_ranked)
+			v = -probe_wdl(p, ok);
+		else if (p.move50() == 0)
+			v = wdl_to_dtz[-probe_wdl(p, ok) + 2];
+		else {
+			v = -probe_dtz(p, ok);
+			v += (v > 0) - (v < 0); // one ply further from the root
+		}
+		p.undo_move(m);
+		if (!ok)
+			return false;
+		rank[i] = v;
+	}
+
+	// which values to keep
+	int lo = 0, hi = 0;
+	if (!dtz_ranked) {
+		lo = hi = *std::max_element(rank.begin(), rank.end());
+	}
+	else if (dtz > 0) {
+		// winning : any win that still fits in the 50 move budget, the fastest one if none does
+		int best = 0xffff;
+		for (const int& v : rank) {
+			if (v > 0)
+				best = std::min(best, v);
+		}
+		lo = 1;
+		hi = (best + cnt50 <= 99 ? 99 - cnt50 : best);
+	}
+	else if (dtz < 0) {
+		// losing : all moves lose, resist the longest only once the 50 move rule gets close
+		const int best = *std::min_element(rank.begin(), rank.end());
+		if (-best * 2 + cnt50 < 100)
+			return true;
+		lo = hi = best;
+	}
+
+	Rootmoves kept;
+	for (size_t i = 0; i < moves.size(); ++i) {
+		if (rank[i] >= lo && rank[i] <= hi)
+			kept.push_back(moves[i]);
+	}
+	if (!kept.empty())
+		moves = kept;
+	return true;
+}
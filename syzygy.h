@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <string>
+
+#include "types.h"
+#include "position.h"
+
+/// <summary>
+/// Syzygy endgame tablebases (WDL and DTZ files, up to 6 men, no castling rights).
+/// init() only lists the .rtbw/.rtbz files of the SyzygyPath directories, a file is memory-mapped on its first probe.
+/// WDL results are from the side to move : -2 loss, -1 loss saved by the 50 move rule, 0 draw,
+/// 1 win spoiled by the 50 move rule, 2 win. Independent of the built-in KPK bitbase (bitbase.h).
+/// </summary>
+namespace syzygy {
+
+	// directories separated by ':' (';' on windows), "" or "<empty>" disables the tables
+	void init(const std::string& paths);
+
+	// most men in a table found (0 : no tables)
+	int max_pieces();
+
+	// few enough men for the tables found and no castling rights
+	bool covers(const position& p);
+
+	// 'ok' is false when a table needed for the position (or one of its captures) is missing
+	int probe_wdl(position& p, bool& ok);
+
+	// plies to the next capture or pawn move of the best line : > 0 win, < 0 loss, 0 draw,
+	// beyond +-100 the result is spoiled by the 50 move rule (the value can be one ply too large)
+	int probe_dtz(position& p, bool& ok);
+
+	// keeps the root moves that hold the tablebase result, 'dtz_ranked' is false when only WDL tables
+	// were available (the best result is kept but nothing guarantees progress)
+	bool filter_root_moves(position& p, Rootmoves& moves, bool& dtz_ranked);
+}
+
+#endif
@@ -14,6 +14,7 @@
 
 #include "material.h"
 #include "pawns.h"
+#include "evalcache.h"
 
 
 class Workerthread {
@@ -35,8 +36,18 @@ public:
 
 class Searchthread : public Workerthread {
 public:
-	material_table materialTable;
 	pawn_table pawnTable;
+	eval_table evalTable;
+	U64 ttEvals = 0; // static evals taken from the transposition table
+	U64 fullEvals = 0; // static evals computed by eval::evaluate
+	U64 probcutTries = 0; // nodes running the probcut capture search
+	U64 probcutCuts = 0; // .. and pruned by it
+	U64 failHighs = 0; // beta cutoffs in the main search
+	U64 failHighsFirst = 0; // .. by the first move searched (move ordering quality)
+	U64 aspirationIterations = 0; // iterative deepening iterations (aspiration windows)
+	U64 aspirationFailLows = 0; // root re-searches after failing low
+	U64 aspirationFailHighs = 0; // .. after failing high
+	U64 tbHits = 0; // exact endgame probes (kpk bitbase, syzygy tables) in the current search
 
 public:
 	Searchthread() {}
@@ -44,7 +55,12 @@ public:
 	~Searchthread() { }
 	Searchthread(const Searchthread& o) {
 		pawnTable = o.pawnTable;
-		materialTable = o.materialTable;
+		evalTable = o.evalTable;
+	}
+
+	void resize_tables(size_t pawnMb) {
+		if (pawnMb != pawnTable.size_mb())
+			pawnTable.resize(pawnMb);
 	}
 };
 
@@ -89,16 +105,16 @@ private:
 
 
 public:
-	Threadpool<T>() { }
+	Threadpool() { }
 
-	Threadpool<T>(const unsigned int n) :
+	Threadpool(const unsigned int n) :
 		busy(0), processed(0), stop(false), num_threads(n)
 	{
 		for (unsigned int i = 0; i < n; ++i)
 			workers.emplace_back(new T(std::bind(&Threadpool<T>::thread_func, this)));
 	}
 
-	~Threadpool<T>() { if (!stop) exit(); }
+	~Threadpool() { if (!stop) exit(); }
 
 	T* operator[](const int& idx) { return workers[idx]; }
 
@@ -24,10 +24,6 @@ void parse_args(int argc, char * argv[]);
 
 int main(int argc, char * argv[]) {
   
-  zobrist::load();
-  
-  bitboards::load();
-  
   magics::load();
 
   
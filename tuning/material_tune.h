@@ -139,21 +139,21 @@ struct material_score {
     for (Color c = white; c <= black; ++c ) {
 
       U64 pawns = (c == white ? p.get_pieces<white, pawn>() : p.get_pieces<black, pawn>());
-      Square * knights = (c == white ? p.squares_of<white, knight>() : p.squares_of<black, knight>());
-      Square * bishops = (c == white ? p.squares_of<white, bishop>() : p.squares_of<black, bishop>());
-      Square * rooks = ( c == white ? p.squares_of<white, rook>() : p.squares_of<black, rook>());
-      Square * queens = (c == white ? p.squares_of<white, queen>() : p.squares_of<black, queen>());
+      U64 knights = (c == white ? p.get_pieces<white, knight>() : p.get_pieces<black, knight>());
+      U64 bishops = (c == white ? p.get_pieces<white, bishop>() : p.get_pieces<black, bishop>());
+      U64 rooks = ( c == white ? p.get_pieces<white, rook>() : p.get_pieces<black, rook>());
+      U64 queens = (c == white ? p.get_pieces<white, queen>() : p.get_pieces<black, queen>());
       
         
       while(pawns) { ++num_pawns[c]; pop_lsb(pawns); }
     
-      for (Square s = *knights; s != no_square; s = *++knights) { ++num_knights[c]; }
+      num_knights[c] += bits::count(knights);
       
-      for (Square s = *bishops; s != no_square; s = *++bishops) { ++num_bishops[c]; }
+      num_bishops[c] += bits::count(bishops);
       
-      for (Square s = *rooks; s != no_square; s = *++rooks) { ++num_rooks[c]; }
+      num_rooks[c] += bits::count(rooks);
       
-      for (Square s = *queens; s != no_square; s = *++queens) { ++num_queens[c]; }
+      num_queens[c] += bits::count(queens);
     }
     empty = false;
   }  
@@ -94,33 +94,23 @@ struct square_scores {
   
   void update(const position& p) {
     U64 pawns = p.get_pieces<white, pawn>();
-    Square * knights = p.squares_of<white, knight>();    
-    Square * bishops = p.squares_of<white, bishop>();
-    Square * rooks = p.squares_of<white, rook>();
-    Square * queens = p.squares_of<white, queen>();
-    Square * kings = p.squares_of<white, king>();
+    U64 knights = p.get_pieces<white, knight>();
+    U64 bishops = p.get_pieces<white, bishop>();
+    U64 rooks = p.get_pieces<white, rook>();
+    U64 queens = p.get_pieces<white, queen>();
+    U64 kings = p.get_pieces<white, king>();
 
     while(pawns) { ++pawn_sc[pop_lsb(pawns)]; }
     
-    for (Square s = *knights; s != no_square; s = *++knights) {
-      ++knight_sc[s];
-    }
+    while(knights) { ++knight_sc[pop_lsb(knights)]; }
 
-    for (Square s = *bishops; s != no_square; s = *++bishops) {
-      ++bishop_sc[s];
-    }
+    while(bishops) { ++bishop_sc[pop_lsb(bishops)]; }
     
-    for (Square s = *rooks; s != no_square; s = *++rooks) {
-      ++rook_sc[s];
-    }
+    while(rooks) { ++rook_sc[pop_lsb(rooks)]; }
     
-    for (Square s = *queens; s != no_square; s = *++queens) {
-      ++queen_sc[s];
-    }
+    while(queens) { ++queen_sc[pop_lsb(queens)]; }
     
-    for (Square s = *kings; s != no_square; s = *++kings) {
-      ++king_sc[s];
-    }
+    while(kings) { ++king_sc[pop_lsb(kings)]; }
 
     ++total;
   }
@@ -1,5 +1,8 @@
 
 #include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
 
 #include "position.h"
 #include "evaluate.h"
@@ -24,13 +27,20 @@ namespace haVoc {
 		U64 correct = 0;
 		U64 total = entries.size();
 		haVoc::EvalEntries incorrect;
+
+		std::vector<std::string> fens;
+		fens.reserve(entries.size());
+		for (const auto& e : entries)
+			fens.push_back(e.first);
+
+		std::vector<float> evals(fens.size());
+		unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+		eval::evaluate_batch(fens, evals, {}, threads);
+
+		size_t idx = 0;
 		for (const auto& e : entries) {
 			auto score = e.second;
-
-			std::istringstream fen(e.first);
-			position board(fen);
-			auto eval = eval::evaluate(board, *SearchThreads[0], -1);
-			auto diff = std::abs((float)score - eval);
+			auto diff = std::abs((float)score - evals[idx++]);
 			if (diff <= 50)
 				correct++;
 			else
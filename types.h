@@ -3,11 +3,13 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <bit>
 #include <vector>
 #include <map>
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <cstring>
 
 #ifdef _MSC_VER
 #include <cstdint>
@@ -50,38 +52,39 @@ enum Movetype {
 	quiet,
 	capture,
 	ep,
+	no_type, // last type stored in a move (4 bits)
 	castles,
 	pseudo_legal,
 	promotion,
 	capture_promotion,
-	no_type
+	quiet_check // quiet moves giving check (qsearch)
 };
 
+/// <summary>
+/// Packed 16 bit move : 6 bit from-square, 6 bit to-square, 4 bit move type.
+/// Trivially copyable so move lists, killers, counters, pv arrays and tt entries
+/// are plain 2 byte copies.
+/// </summary>
 struct Move {
-	U8 f = 0;
-	U8 t = 0;
-	U8 type = Movetype::no_type;
-	Move() {}
-	Move(const Move& m)
-	{
-		f = m.f; t = m.t; type = m.type;
-	}
+	U16 f : 6;
+	U16 t : 6;
+	U16 type : 4;
 
-	inline Move& operator=(const Move& m) {
-		f = m.f; t = m.t; type = m.type;
-		return *this;
-	}
-	inline bool operator==(const Move& m) const {
-		return (f == m.f && t == m.t && type == m.type);
-	}
-	inline bool operator!=(const Move& m) const {
-		return (f != m.f || t != m.t || type != m.type);
-	}
+	Move() { set(U16(Movetype::no_type << 12)); }
+	Move(const U8& frm, const U8& to, const Movetype& mt) { set(frm, to, mt); }
+
+	// raw 16 bit value (f | t << 6 | type << 12 with the gcc/msvc bit field layout)
+	inline U16 data() const { return std::bit_cast<U16>(*this); }
+	inline bool operator==(const Move& m) const { return data() == m.data(); }
+	inline bool operator!=(const Move& m) const { return data() != m.data(); }
 	inline void set(const U8& frm, const U8& to, const Movetype& mt) {
-		f = frm; t = to; type = mt;
+		set(U16(frm | (to << 6) | (mt << 12))); // one 16 bit store
 	}
+	inline void set(const U16& d) { *this = std::bit_cast<Move>(d); }
 };
 
+static_assert(sizeof(Move) == 2, "moves are packed into 16 bits");
+
 
 
 // enums
@@ -102,7 +105,7 @@ enum Square {
 enum Row { r1, r2, r3, r4, r5, r6, r7, r8, rows, no_row };
 enum Col { A, B, C, D, E, F, G, H, cols, no_col };
 enum Depth { ZERO=0, MAX_PLY=64 };
-enum Score { inf = 10000, ninf = -10000, mate = inf - 1, mated = ninf + 1, mate_max_ply = mate - 64, mated_max_ply = mated + 64, draw = 0 };
+enum Score { inf = 10000, ninf = -10000, mate = inf - 1, mated = ninf + 1, mate_max_ply = mate - 64, mated_max_ply = mated + 64, tb_win = mate_max_ply - 1, draw = 0 };
 enum Nodetype { root, pv, non_pv, searching = 128 };
 enum OrderPhase { hash_move, mate_killer1, mate_killer2, good_captures, killer1, killer2, bad_captures, quiets, end };
 
@@ -205,8 +208,12 @@ struct node {
 	bool in_check		= false;
 	bool null_search	= false;
 	bool gen_checks		= false;
+	bool cut_node		= false; // expected to fail high (child of an all node, or a late move of a pv node)
 	Move curr_move, best_move, threat_move;
+	Move excluded_move; // singular extension verification : searched without this move (no_type : none)
+	Piece moved = Piece::no_piece; // piece played by curr_move (no_piece : null move / none)
 	Move* pv = nullptr;
+	Move* pv_row = nullptr; // this ply's row of the thread's triangular pv table
 	int selDepth = 0;
 	//int capHistory[2][64][64];
 	History::bmHistory * bestMoveHistory;
@@ -226,13 +233,13 @@ template<> struct is_enum<OrderPhase> : std::true_type {};
 
 template<typename T,
 	typename = typename std::enable_if<is_enum<T>::value>::type >
-	int operator++(T& e) {
+	constexpr int operator++(T& e) {
 	e = T((int)e + 1); return int(e);
 }
 
 template<typename T,
 	typename = typename std::enable_if<is_enum<T>::value>::type >
-	int operator--(T& e) {
+	constexpr int operator--(T& e) {
 	e = T((int)e - 1); return int(e);
 }
 
@@ -5,6 +5,7 @@
 #include "search.h"
 #include "threads.h"
 #include "hashtable.h"
+#include "syzygy.h"
 //#include "tuning_manager.h"
 #include "threads.h"
 
@@ -13,11 +14,18 @@ Move dbgmove;
 Threadpool<Workerthread> worker(1);
 signals UCI_SIGNALS;
 
+static void resize_search_tables() {
+	size_t pawnMb = std::max(opts->value<int>("pawnhash"), 1);
+	for (unsigned i = 0; i < SearchThreads.num_workers(); ++i)
+		SearchThreads[i]->resize_tables(pawnMb);
+}
+
 void uci::loop() {
 	uci_pos.params = eval::Parameters;
 
 	int numThreads = std::max(opts->value<int>("threads"), 1);
 	SearchThreads.init(numThreads);
+	resize_search_tables();
 
 	std::string input = "";
 	while (std::getline(std::cin, input)) {
@@ -55,6 +63,8 @@ bool uci::parse_command(const std::string& input) {
 		}
 		else if (cmd == "setoption" && instream >> cmd && instream >> cmd)
 		{
+			std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+
 			if (cmd == "hash" && instream >> cmd && instream >> cmd)
 			{
 				auto sz = atoi(cmd.c_str());
@@ -62,6 +72,12 @@ bool uci::parse_command(const std::string& input) {
 				ttable.resize(sz);
 				break;
 			}
+			if (cmd == "pawnhash" && instream >> cmd && instream >> cmd)
+			{
+				opts->set("pawnhash", atoi(cmd.c_str()));
+				if (!Search::searching) resize_search_tables();
+				break;
+			}
 			if (cmd == "clear" && instream >> cmd)
 			{
 				if (cmd == "hash")
@@ -77,6 +93,23 @@ bool uci::parse_command(const std::string& input) {
 				opts->set("multipv", atoi(cmd.c_str()));
 				break;
 			}
+			if (cmd == "move" && instream >> cmd)
+			{
+				std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+				if (cmd == "overhead" && instream >> cmd && instream >> cmd)
+					opts->set("moveoverhead", std::max(atoi(cmd.c_str()), 0));
+				break;
+			}
+			if (cmd == "syzygypath" && instream >> cmd)
+			{
+				std::string path;
+				std::getline(instream >> std::ws, path);
+				while (!path.empty() && std::isspace(static_cast<unsigned char>(path.back())))
+					path.pop_back();
+				opts->set("syzygypath", path.empty() ? std::string("<empty>") : path);
+				if (!Search::searching) syzygy::init(path);
+				break;
+			}
 		}
 		else if (cmd == "d") {
 			uci_pos.print();
@@ -88,6 +121,16 @@ bool uci::parse_command(const std::string& input) {
 			std::cout << "position hash key: " << uci_pos.key() << std::endl;
 			std::cout << "evaluation: " << eval::evaluate(uci_pos, *SearchThreads[0], -1) << std::endl;
 		}
+		else if (cmd == "tbprobe") {
+			bool wdl_ok = false, dtz_ok = false;
+			int wdl = 0, dtz = 0;
+			if (syzygy::covers(uci_pos)) {
+				wdl = syzygy::probe_wdl(uci_pos, wdl_ok);
+				dtz = syzygy::probe_dtz(uci_pos, dtz_ok);
+			}
+			std::cout << "wdl " << (wdl_ok ? std::to_string(wdl) : "none")
+				<< " dtz " << (dtz_ok ? std::to_string(dtz) : "none") << std::endl;
+		}
 		else if (cmd == "undo") {
 			uci_pos.undo_move(dbgmove);
 		}
@@ -159,7 +202,30 @@ bool uci::parse_command(const std::string& input) {
 		}
 		else if (cmd == "perft" && instream >> cmd) {
 			Perft perft;
-			perft.go(atoi(cmd.c_str()));
+			int depth = atoi(cmd.c_str());
+			unsigned threads = 1;
+			size_t hash_mb = 64;
+			if (instream >> cmd)
+				threads = std::max(atoi(cmd.c_str()), 1);
+			if (instream >> cmd)
+				hash_mb = size_t(std::max(atoi(cmd.c_str()), 0));
+			perft.go(depth, threads, hash_mb);
+		}
+		else if (cmd == "perftsuite") {
+			Perft perft;
+			std::string filename = "tuning/epd/perft.epd";
+			int depth = 5;
+			unsigned threads = std::max(opts->value<int>("threads"), 1);
+			size_t hash_mb = 64;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				depth = atoi(cmd.c_str());
+			if (instream >> cmd)
+				threads = std::max(atoi(cmd.c_str()), 1);
+			if (instream >> cmd)
+				hash_mb = size_t(std::max(atoi(cmd.c_str()), 0));
+			perft.suite(filename, depth, threads, hash_mb);
 		}
 		else if (cmd == "gen" && instream >> cmd) {
 			Perft perft;
@@ -177,7 +243,92 @@ bool uci::parse_command(const std::string& input) {
 		else if (cmd == "bench" && instream >> cmd) {
 			Perft perft;
 			int depth = atoi(cmd.c_str());
-			perft.bench(depth, true);
+			std::string filename = "tuning/epd/mini-test.txt";
+			if (instream >> cmd)
+				filename = cmd;
+			perft.bench(depth, filename, true);
+		}
+		else if (cmd == "pawnbench") {
+			Perft perft;
+			std::string filename = "tuning/epd/tests.txt";
+			int iterations = 1000;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				iterations = atoi(cmd.c_str());
+			perft.pawn_bench(filename, iterations);
+		}
+		else if (cmd == "evalbench") {
+			Perft perft;
+			std::string filename = "tuning/epd/tests.txt";
+			unsigned threads = std::max(opts->value<int>("threads"), 1);
+			int repeat = 20;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				threads = atoi(cmd.c_str());
+			if (instream >> cmd)
+				repeat = atoi(cmd.c_str());
+			perft.eval_bench(filename, threads, repeat);
+		}
+		else if (cmd == "startupbench") {
+			Perft perft;
+			int iterations = 10;
+			if (instream >> cmd)
+				iterations = std::max(atoi(cmd.c_str()), 1);
+			perft.startup_bench(iterations);
+		}
+		else if (cmd == "repbench") {
+			Perft perft;
+			std::string filename = "tuning/epd/tests.txt";
+			int plies = 600;
+			int iterations = 100;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				plies = std::max(atoi(cmd.c_str()), 1);
+			if (instream >> cmd)
+				iterations = std::max(atoi(cmd.c_str()), 1);
+			perft.rep_bench(filename, plies, iterations);
+		}
+		else if (cmd == "seebench") {
+			Perft perft;
+			std::string filename = "tuning/epd/tests.txt";
+			int iterations = 1000;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				iterations = std::max(atoi(cmd.c_str()), 1);
+			perft.see_bench(filename, iterations);
+		}
+		else if (cmd == "checkgen") {
+			Perft perft;
+			std::string filename = "tuning/epd/tests.txt";
+			int plies = 2;
+			if (instream >> cmd)
+				filename = cmd;
+			if (instream >> cmd)
+				plies = std::max(atoi(cmd.c_str()), 0);
+			perft.check_gen(filename, plies);
+		}
+		else if (cmd == "tbtest") {
+			Perft perft;
+			std::string filename = "tuning/epd/syzygy.epd";
+			if (instream >> cmd)
+				filename = cmd;
+			perft.tb_test(filename);
+		}
+		else if (cmd == "hashstats") {
+#ifdef HAVOC_KEY128
+			U64 probes = ttable.probe_count();
+			std::cout << "probes " << probes
+				<< " hits " << ttable.hit_count()
+				<< " collisions " << ttable.collision_count()
+				<< " (" << (probes > 0 ? 1e6 * double(ttable.collision_count()) / double(probes) : 0.0) << " per million probes)"
+				<< std::endl;
+#else
+			std::cout << "hashstats : build with HAVOC_KEY128 to count hash key collisions" << std::endl;
+#endif
 		}
 		else if (cmd == "debug") {
 			uci_pos.debug_search = !uci_pos.debug_search;
@@ -187,6 +338,7 @@ bool uci::parse_command(const std::string& input) {
 
 		// game specific uci commands (refactor?)
 		else if (cmd == "isready") {
+			ttable.init();
 			ttable.clear();
 			std::cout << "readyok" << std::endl;
 		}
@@ -213,6 +365,7 @@ bool uci::parse_command(const std::string& input) {
 			int numThreads = std::max(opts->value<int>("threads"), 1);
 			if (numThreads != SearchThreads.num_workers())
 				SearchThreads.init(numThreads);
+			resize_search_tables();
 
 			bool silent = false;
 			worker.enqueue(Search::start, uci_pos, lims, silent);
@@ -242,6 +395,9 @@ bool uci::parse_command(const std::string& input) {
 			std::cout << "option name Threads type spin default 1 min 1 max 1024" << std::endl;
 			std::cout << "option name Hash type spin default 1024 min 1 max 33554432" << std::endl;
 			std::cout << "option name MultiPV type spin default 1 min 1 max 4" << std::endl;
+			std::cout << "option name PawnHash type spin default 4 min 1 max 1024" << std::endl;
+			std::cout << "option name Move Overhead type spin default 30 min 0 max 5000" << std::endl;
+			std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
 			std::cout << "uciok" << std::endl;
 		}
 
@@ -277,19 +433,22 @@ void uci::load_position(const std::string& pos) {
 
 }
 
-std::string uci::move_to_string(const Move& m) {
-	auto fromto = SanSquares[m.f] + SanSquares[m.t];
+size_t uci::move_to_chars(const Move& m, char* out) {
+	out[0] = char('a' + util::col(m.f));
+	out[1] = char('1' + util::row(m.f));
+	out[2] = char('a' + util::col(m.t));
+	out[3] = char('1' + util::row(m.t));
+
 	Movetype t = Movetype(m.type);
+	if (t > capture_promotion_n)
+		return 4;
 
-	auto ps = (t == capture_promotion_q ? "q" :
-		t == capture_promotion_r ? "r" :
-		t == capture_promotion_b ? "b" :
-		t == capture_promotion_n ? "n" :
-		t == promotion_q ? "q" :
-		t == promotion_r ? "r" :
-		t == promotion_b ? "b" :
-		t == promotion_n ? "n" : "");
+	out[4] = "qrbn"[t & 3];
+	return 5;
+}
 
-	return fromto + ps;
+std::string uci::move_to_string(const Move& m) {
+	char buf[5];
+	return std::string(buf, move_to_chars(m, buf));
 }
 
@@ -9,6 +9,8 @@
 #include <stdio.h>
 #include <algorithm>
 #include <string>
+#include <charconv>
+#include <type_traits>
 
 #include "bits.h"
 #include "types.h"
@@ -32,6 +34,44 @@ namespace uci {
 	bool parse_command(const std::string& input);
 	void load_position(const std::string& pos);
 	std::string move_to_string(const Move& m);
+	size_t move_to_chars(const Move& m, char* out);
+
+	/// <summary>
+	/// Reusable output buffer for search info lines, text is appended in place and numbers
+	/// are formatted with to_chars so reporting does not allocate however often it prints.
+	/// </summary>
+	class info_buffer {
+		char buf[16384];
+		size_t len = 0;
+
+	public:
+		inline info_buffer& operator<<(const char* s) {
+			size_t n = strlen(s);
+			if (len + n <= sizeof(buf)) {
+				std::memcpy(buf + len, s, n);
+				len += n;
+			}
+			return *this;
+		}
+
+		template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+		inline info_buffer& operator<<(const T& v) {
+			auto r = std::to_chars(buf + len, buf + sizeof(buf), v);
+			if (r.ec == std::errc()) len = size_t(r.ptr - buf);
+			return *this;
+		}
+
+		inline info_buffer& operator<<(const Move& m) {
+			if (len + 5 <= sizeof(buf)) len += move_to_chars(m, buf + len);
+			return *this;
+		}
+
+		inline void flush(std::ostream& os) {
+			os.write(buf, std::streamsize(len));
+			os.flush();
+			len = 0;
+		}
+	};
 }
 
 extern signals UCI_SIGNALS;
@@ -33,29 +33,29 @@ namespace util {
 	}
 
 
-	inline int row(const int& r) { return (r >> 3); }
-	inline int col(const int& c) { return c & 7; }
-	inline int row_dist(const int& s1, const int& s2) { return abs(row(s1) - row(s2)); }
-	inline int col_dist(const int& s1, const int& s2) { return abs(col(s1) - col(s2)); }
-	inline bool on_board(const int& s1) { return s1 >= 0 && s1 <= 63; }
-	inline bool same_row(const int& s1, const int& s2) { return row(s1) == row(s2); }
-	inline bool same_col(const int& s1, const int& s2) { return col(s1) == col(s2); }
-	inline bool on_diagonal(const int& s1, const int& s2) { return col_dist(s1, s2) == row_dist(s1, s2); }
-	inline bool aligned(const int& s1, const int& s2) {
+	constexpr int row(const int& r) { return (r >> 3); }
+	constexpr int col(const int& c) { return c & 7; }
+	constexpr int row_dist(const int& s1, const int& s2) { return row(s1) > row(s2) ? row(s1) - row(s2) : row(s2) - row(s1); }
+	constexpr int col_dist(const int& s1, const int& s2) { return col(s1) > col(s2) ? col(s1) - col(s2) : col(s2) - col(s1); }
+	constexpr bool on_board(const int& s1) { return s1 >= 0 && s1 <= 63; }
+	constexpr bool same_row(const int& s1, const int& s2) { return row(s1) == row(s2); }
+	constexpr bool same_col(const int& s1, const int& s2) { return col(s1) == col(s2); }
+	constexpr bool on_diagonal(const int& s1, const int& s2) { return col_dist(s1, s2) == row_dist(s1, s2); }
+	constexpr bool aligned(const int& s1, const int& s2) {
 		return on_diagonal(s1, s2) || same_row(s1, s2) || same_col(s1, s2);
 	}
-	inline bool aligned(const int& s1, const int& s2, const int& s3) {
+	constexpr bool aligned(const int& s1, const int& s2, const int& s3) {
 		return (same_col(s1, s2) && same_col(s1, s3)) ||
 			(same_row(s1, s2) && same_row(s1, s3)) ||
 			(on_diagonal(s1, s3) && on_diagonal(s1, s2) && on_diagonal(s2, s3));
 	}
 
-	inline U64 squares_infront(const U64& colbb, const Color& c, const int& s) {
+	constexpr U64 squares_infront(const U64& colbb, const Color& c, const int& s) {
 		return (c == white ? colbb << 8 * (row(s) + 1) : colbb >> 8 * (8 - row(s)));
 	}
 
 
-	inline U64 squares_behind(U64& colbb, const Color& c, const int& s) {
+	constexpr U64 squares_behind(const U64& colbb, const Color& c, const int& s) {
 		return ~squares_infront(colbb, c, s) & colbb;
 	}
 
@@ -1,120 +1,107 @@
+#include <utility>
 
 #include "zobrist.h"
 #include "bits.h"
 #include "zobristrands.h"
 
 namespace zobrist {
-	U64 piece_rands[Square::squares][2][pieces];
-	U64 castle_rands[2][16];
-	U64 ep_rands[8];
-	U64 stm_rands[2];
-	U64 move50_rands[512];
-	U64 hmv_rands[512];
-}
-
-
-U64 zobrist::gen(const unsigned int& bits, util::rand<unsigned int>& r) {
-	U64 res = 0ULL;
-	for (unsigned int i = 0; i < bits; ++i) res |= (1ULL << (r.next() & 63));
-	return res;
-}
-
-const unsigned _bits = 25;
-
-bool zobrist::load() {
 
-	const unsigned int N = 1835;
-	std::vector<U64> rands;
-	util::rand<unsigned int> R;
-
-	//bool ok = true;
-	//unsigned count = 0;
-	//while (rands.size() < N) {
-
-	//  U64 rand = R.next(); // gen(bits, R);
-	//  
-	//  // filter zobrist keys to be unique
-	//  // and favor smaller values (bits distributed near lower half)
-	//  if (bits::count(rand) > 4) continue;
-	//  
-	//  U64 filter_low = (rand >> 20); // 0x000000FFFFFFFF;
-	//  if (bits::count(filter_low) >= 3) continue;
-
-	//  //U64 filter_high = (rand << 20); // 0xFFFFFFFF;
-	//  //if (bits::count(filter_high) <= 3) continue;
-
-	//  for (unsigned i = 0; i < rands.size(); ++i) {
-	//    ok = (rand != rands[i]);
-	//    if (!ok) break;
-	//  }
-	//  
-	//  if (ok) {
-	//    count = ((count + 1) % 6 == 0 ? 0 : count + 1);
-	//    std::string eol((count != 0 ? "), " : "),\n"));
-	//    std::cout << "ULL(" << rand << eol;
-	//    rands.emplace_back(rand);
-	//  }
-
-	//}
-
-	// pieces
-	unsigned int idx = 0;
-	for (Square sq = A1; sq <= H8; ++sq) {
-		for (Color c = white; c <= black; ++c) {
-			for (Piece p = pawn; p <= king; ++p, ++idx) {
-				piece_rands[sq][c][p] = zobrist_rands[idx]; // gen(bits, R);//gen.next();
-			}
-		}
+	// rands are consumed in order : pieces, castle rights, ep, side to move
+	constexpr unsigned castle_offset = Square::squares * 2 * pieces;
+	constexpr unsigned ep_offset = castle_offset + 16;
+	constexpr unsigned side_offset = ep_offset + 8;
+	static_assert(side_offset + 1 <= sizeof(zobrist_rands) / sizeof(zobrist_rands[0]));
+
+	// the listed rands are sparse values below 2^32, the splitmix64 finalizer (a bijection, so they stay unique)
+	// spreads them over all 64 bits. Otherwise the upper key bits are always zero and distinct positions collide.
+	constexpr U64 mix(U64 x) {
+		x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
 	}
 
-
-	// castle rights
-	for (Color c = white; c <= black; ++c) {
-		for (int bit = 0; bit < 16; ++bit, ++idx) {
-			castle_rands[c][bit] = zobrist_rands[idx]; // gen(bits, R);// .next();
-		}
+	// 'salt' selects an independent set of keys from the same list (0 : primary key)
+	template<U64 salt>
+	constexpr std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> make_piece_rands() {
+		std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> t{};
+		unsigned idx = 0;
+		for (int sq = A1; sq <= H8; ++sq)
+			for (int c = white; c <= black; ++c)
+				for (int p = pawn; p <= king; ++p, ++idx) t[sq][c][p] = mix(zobrist_rands[idx] ^ salt);
+		return t;
 	}
 
-
-	// ep
-	for (int col = 0; col < 8; ++col, ++idx) {
-		ep_rands[col] = zobrist_rands[idx]; // gen(bits, R); // gen.next();
+	template<U64 salt>
+	constexpr std::array<U64, 16> make_castle_rands() {
+		std::array<U64, 16> t{};
+		for (int m = 1; m < 16; ++m) t[m] = mix(zobrist_rands[castle_offset + m] ^ salt);
+		return t; // no rights : 0
 	}
 
-	// stm
-	stm_rands[white] = zobrist_rands[idx++]; // gen(bits, R); // .next();
-	stm_rands[black] = zobrist_rands[idx++]; // gen(bits, R); // .next();
-
-
-	for (int m = 0; m < 512; ++m, idx += 2) {
-		move50_rands[m] = zobrist_rands[idx]; // gen(bits, R); // .next();
-		hmv_rands[m] = zobrist_rands[idx + 1]; // gen(bits, R);// .next();
+	template<U64 salt>
+	constexpr std::array<U64, 8> make_ep_rands() {
+		std::array<U64, 8> t{};
+		for (int col = 0; col < 8; ++col) t[col] = mix(zobrist_rands[ep_offset + col] ^ salt);
+		return t;
 	}
 
-	return true;
-}
-
-
-U64 zobrist::piece(const Square& s, const Color& c, const Piece& p) {
-	return piece_rands[s][c][p];
-}
-
-U64 zobrist::castle(const Color& c, const U16& bit) {
-	return castle_rands[c][bit];
-}
-
-U64 zobrist::ep(const U8& column) {
-	return ep_rands[column];
-}
+	constexpr std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> piece_rands = make_piece_rands<0>();
+	constexpr std::array<U64, 16> castle_rands = make_castle_rands<0>();
+	constexpr std::array<U64, 8> ep_rands = make_ep_rands<0>();
+	constexpr U64 side_rand = mix(zobrist_rands[side_offset]);
+
+	// true if p moves from s1 to s2 on an empty board
+	constexpr bool reaches(const int& p, const int& s1, const int& s2) {
+		const int dc = util::col_dist(s1, s2);
+		const int dr = util::row_dist(s1, s2);
+		switch (p) {
+		case knight: return (dc == 1 && dr == 2) || (dc == 2 && dr == 1);
+		case bishop: return dc == dr;
+		case rook: return dc == 0 || dr == 0;
+		case queen: return dc == dr || dc == 0 || dr == 0;
+		case king: return dc <= 1 && dr <= 1;
+		default: return false;
+		}
+	}
 
-U64 zobrist::stm(const Color& c) {
-	return stm_rands[c];
+	constexpr cuckoo_table cuckoo = [] {
+		cuckoo_table t{};
+		for (int c = white; c <= black; ++c)
+			for (int p = knight; p <= king; ++p)
+				for (int s1 = A1; s1 <= H8; ++s1)
+					for (int s2 = s1 + 1; s2 <= H8; ++s2) {
+						if (!reaches(p, s1, s2))
+							continue;
+
+						U64 key = piece_rands[s1][c][p] ^ piece_rands[s2][c][p] ^ side_rand;
+						U16 move = U16(s1 | (s2 << 6));
+						unsigned i = cuckoo_h1(key);
+
+						// insert, displacing the occupant to its alternate slot until an empty slot is hit
+						while (true) {
+							std::swap(t.keys[i], key);
+							std::swap(t.moves[i], move);
+							if (move == 0) break;
+							i = (i == cuckoo_h1(key) ? cuckoo_h2(key) : cuckoo_h1(key));
+						}
+						++t.count;
+					}
+		return t;
+	}();
+	static_assert(cuckoo.count == 3668, "unexpected number of reversible moves");
+
+#ifdef HAVOC_KEY128
+	constexpr U64 salt2 = 0x9E3779B97F4A7C15ULL;
+	constexpr std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> piece_rands2 = make_piece_rands<salt2>();
+	constexpr std::array<U64, 16> castle_rands2 = make_castle_rands<salt2>();
+	constexpr std::array<U64, 8> ep_rands2 = make_ep_rands<salt2>();
+	constexpr U64 side_rand2 = mix(zobrist_rands[side_offset] ^ salt2);
+#endif
 }
 
-U64 zobrist::mv50(const U16& count) {
-	return move50_rands[count];
-}
 
-U64 zobrist::hmvs(const U16& count) {
-	return hmv_rands[count];
+U64 zobrist::gen(const unsigned int& bits, util::rand<unsigned int>& r) {
+	U64 res = 0ULL;
+	for (unsigned int i = 0; i < bits; ++i) res |= (1ULL << (r.next() & 63));
+	return res;
 }
@@ -1,28 +1,59 @@
-
 #pragma once
 
 #ifndef ZOBRIST_H
 #define ZOBRIST_H
 
+#include <array>
+
 #include "types.h"
 #include "utils.h"
 
+/// <summary>
+/// Zobrist keys are taken from the fixed random list in zobristrands.h (mixed to full 64 bit values),
+/// the tables are filled at compile time so no startup initialization is needed.
+/// The key only describes the position (pieces, side to move, castle rights and ep square),
+/// with HAVOC_KEY128 an independent second set of tables feeds the 64 bit verification key.
+/// </summary>
 namespace zobrist {
-	bool load();
-	U64 piece(const Square& s, const Color& c, const Piece& p);
-	U64 castle(const Color& c, const U16& bit);
-	U64 ep(const U8& column);
-	U64 stm(const Color& c);
-	U64 mv50(const U16& count);
-	U64 hmvs(const U16& count);
 	U64 gen(const unsigned int& bits, util::rand<unsigned int>& r);
 
-	extern U64 piece_rands[Square::squares][2][pieces];
-	extern U64 castle_rands[2][16];
-	extern U64 ep_rands[8];
-	extern U64 stm_rands[2];
-	extern U64 move50_rands[512];
-	extern U64 hmv_rands[512];
+	extern const std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> piece_rands;
+	extern const std::array<U64, 16> castle_rands; // indexed by the full castle rights mask
+	extern const std::array<U64, 8> ep_rands;
+	extern const U64 side_rand; // toggled on every move, set when black is to move
+
+	inline U64 piece(const Square& s, const Color& c, const Piece& p) { return piece_rands[s][c][p]; }
+	inline U64 castle(const U16& cmask) { return castle_rands[cmask]; }
+	inline U64 ep(const U8& column) { return ep_rands[column]; }
+	inline U64 side() { return side_rand; }
+
+	/// <summary>
+	/// Cuckoo table of every reversible (non-pawn) move on an empty board, keyed by the key difference
+	/// the move makes (from ^ to ^ side). Two keys one move apart identify the move in at most two probes.
+	/// </summary>
+	constexpr unsigned cuckoo_size = 8192;
+	constexpr unsigned cuckoo_h1(const U64& k) { return unsigned(k & (cuckoo_size - 1)); }
+	constexpr unsigned cuckoo_h2(const U64& k) { return unsigned((k >> 16) & (cuckoo_size - 1)); }
+
+	struct cuckoo_table {
+		std::array<U64, cuckoo_size> keys;
+		std::array<U16, cuckoo_size> moves; // from | to << 6, 0 : empty slot
+		unsigned count;
+	};
+
+	extern const cuckoo_table cuckoo;
+
+#ifdef HAVOC_KEY128
+	extern const std::array<std::array<std::array<U64, pieces>, 2>, Square::squares> piece_rands2;
+	extern const std::array<U64, 16> castle_rands2;
+	extern const std::array<U64, 8> ep_rands2;
+	extern const U64 side_rand2;
+
+	inline U64 piece2(const Square& s, const Color& c, const Piece& p) { return piece_rands2[s][c][p]; }
+	inline U64 castle2(const U16& cmask) { return castle_rands2[cmask]; }
+	inline U64 ep2(const U8& column) { return ep_rands2[column]; }
+	inline U64 side2() { return side_rand2; }
+#endif
 }
 
 #endif
@@ -6,7 +6,7 @@
 
 
 namespace {
-	std::vector<U64> zobrist_rands =
+	constexpr U64 zobrist_rands[] =
 	{
 		U64(67240961), U64(671088643), U64(136445952), U64(268599298), U64(4194353), U64(33595393),
 		U64(75530496), U64(33554460), U64(4374528), U64(1069057), U64(16810116), U64(270532613),